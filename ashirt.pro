@@ -1,4 +1,4 @@
-QT       += core gui network sql
+QT       += core gui network sql concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -46,6 +46,7 @@ INCLUDEPATH += src
 SOURCES += \
     src/components/aspectratio_pixmap_label/aspectratiopixmaplabel.cpp \
     src/components/aspectratio_pixmap_label/imageview.cpp \
+    src/components/capture_overlay/captureoverlay.cpp \
     src/components/code_editor/codeblockview.cpp \
     src/components/code_editor/codeeditor.cpp \
     src/components/custom_keyseq_edit/singlestrokekeysequenceedit.cpp \
@@ -61,25 +62,34 @@ SOURCES += \
     src/components/tagging/tagview.cpp \
     src/components/tagging/tagwidget.cpp \
     src/db/databaseconnection.cpp \
+    src/db/databaseworker.cpp \
     src/forms/add_operation/createoperation.cpp \
     src/forms/evidence_filter/evidencefilter.cpp \
     src/forms/evidence_filter/evidencefilterform.cpp \
     src/forms/getinfo/getinfo.cpp \
     src/helpers/clipboard/clipboardhelper.cpp \
     src/models/codeblock.cpp \
+    src/helpers/multipartbodydevice.cpp \
     src/helpers/multipartparser.cpp \
     src/hotkeymanager.cpp \
     src/main.cpp \
     src/traymanager.cpp \
     src/helpers/screenshot.cpp \
     src/helpers/stopreply.cpp \
+    src/helpers/uploadqueue.cpp \
+    src/helpers/burstcapture.cpp \
+    src/helpers/connectivitymonitor.cpp \
+    src/helpers/requesttiming.cpp \
+    src/helpers/throttleddevice.cpp \
     src/forms/credits/credits.cpp \
     src/forms/evidence/evidencemanager.cpp \
+    src/forms/evidence/evidencetablemodel.cpp \
     src/forms/settings/settings.cpp
 
 HEADERS += \
     src/components/aspectratio_pixmap_label/aspectratiopixmaplabel.h \
     src/components/aspectratio_pixmap_label/imageview.h \
+    src/components/capture_overlay/captureoverlay.h \
     src/components/code_editor/codeblockview.h \
     src/components/code_editor/codeeditor.h \
     src/components/custom_keyseq_edit/singlestrokekeysequenceedit.h \
@@ -98,6 +108,7 @@ HEADERS += \
     src/components/tagging/tagview.h \
     src/components/tagging/tagwidget.h \
     src/db/databaseconnection.h \
+    src/db/databaseworker.h \
     src/dtos/github_release.h \
     src/dtos/checkConnection.h \
     src/exceptions/databaseerr.h \
@@ -120,14 +131,22 @@ HEADERS += \
     src/appconfig.h \
     src/appsettings.h \
     src/helpers/jsonhelpers.h \
+    src/helpers/multipartbodydevice.h \
     src/helpers/multipartparser.h \
     src/helpers/netman.h \
+    src/helpers/perceptualhash.h \
     src/helpers/screenshot.h \
     src/helpers/stopreply.h \
+    src/helpers/uploadqueue.h \
+    src/helpers/burstcapture.h \
+    src/helpers/connectivitymonitor.h \
+    src/helpers/requesttiming.h \
+    src/helpers/throttleddevice.h \
     src/dtos/tag.h \
     src/dtos/operation.h \
     src/forms/credits/credits.h \
     src/forms/evidence/evidencemanager.h \
+    src/forms/evidence/evidencetablemodel.h \
     src/forms/settings/settings.h
 
 include(tools/UGlobalHotkey/uglobalhotkey.pri)
@@ -0,0 +1,117 @@
+#! /usr/bin/env python3
+
+# Models the previous connection defaults (rollback journal, synchronous=FULL, every statement
+# prepared per call) against the current ones (see DatabaseConnection::applyConnectionSettings and
+# executeCached), using Python's sqlite3 module, so that no Qt toolchain is needed. This is a model:
+# it runs the same pragmas and statements, but not through Qt's SQLite driver or DatabaseConnection.
+# dbbench makes the same comparison through DatabaseConnection itself.
+#
+# Usage: bench/dbbench/connection_settings.py [evidence-count]   (default: 100000)
+
+import os
+import sqlite3
+import sys
+import tempfile
+import time
+
+INSERT_RUNS = 1000
+LOOKUP_RUNS = 10000
+
+CURRENT_PRAGMAS = [
+    "PRAGMA journal_mode=WAL",
+    "PRAGMA synchronous=NORMAL",
+    "PRAGMA cache_size=-8192",
+    "PRAGMA mmap_size=67108864",
+    "PRAGMA temp_store=MEMORY",
+]
+BASELINE_PRAGMAS = [
+    "PRAGMA journal_mode=DELETE",
+    "PRAGMA synchronous=FULL",
+]
+
+INSERT = ("INSERT INTO evidence (path, operation_slug, content_type, recorded_date)"
+          " VALUES (?, ?, ?, datetime('now'))")
+# the statement run by DatabaseConnection::getEvidenceDetails (see getTaggedEvidence)
+LOOKUPS = [
+    "SELECT e.*, t.id AS tag_row_id, t.tag_id AS tag_server_id, t.name AS tag_name"
+    " FROM (SELECT id, path, operation_slug, content_type, description, error, recorded_date,"
+    "  upload_date, queued_date, upload_attempts, next_retry_date, content_hash"
+    "  FROM evidence WHERE id=? LIMIT 1) AS e"
+    " LEFT JOIN tags t ON t.evidence_id = e.id ORDER BY e.id, t.id",
+]
+
+
+def build_database(path, count):
+    """Builds a migrated database at the given path, seeded with count evidence (and a tag each)"""
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+    migrations = sorted(os.listdir(os.path.join(root, "migrations")))
+    conn = sqlite3.connect(path, isolation_level=None)
+    for migration in migrations:
+        with open(os.path.join(root, "migrations", migration)) as f:
+            up = f.read().split("-- +migrate Down")[0].replace("-- +migrate Up", "")
+        conn.executescript(up)
+    conn.executescript("""
+        BEGIN;
+        WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < %d)
+        INSERT INTO evidence (path, operation_slug, content_type, recorded_date, upload_date)
+        SELECT '/evidence/op' || (i %% 20) || '/ashirt_screenshot_' || i || '.png',
+               'op' || (i %% 20), 'image',
+               datetime('2020-01-01', '+' || (i * 300) || ' seconds'),
+               datetime('2020-01-01', '+' || (i * 300 + 60) || ' seconds')
+        FROM n;
+        INSERT INTO tags (evidence_id, tag_id, name)
+          SELECT id, id %% 50 + 1, 'tag' || (id %% 50 + 1) FROM evidence;
+        COMMIT;
+    """ % count)
+    conn.close()
+
+
+def connect(path, pragmas, cached):
+    # cached_statements=0 makes the module prepare every statement on every call
+    conn = sqlite3.connect(path, isolation_level=None, cached_statements=128 if cached else 0)
+    for pragma in pragmas:
+        conn.execute(pragma).fetchall()
+    return conn
+
+
+def per_second(runs, seconds):
+    return "%10.0f/s" % (runs / seconds)
+
+
+def measure(path, pragmas, cached, count):
+    conn = connect(path, pragmas, cached)
+    start = time.perf_counter()
+    for _ in range(INSERT_RUNS):
+        conn.execute(INSERT, ("/evidence/op3/bench.png", "op3", "image"))
+    inserts = time.perf_counter() - start
+
+    start = time.perf_counter()
+    for i in range(LOOKUP_RUNS):
+        for lookup in LOOKUPS:
+            conn.execute(lookup, (i * 7919 % count + 1,)).fetchall()
+    lookups = time.perf_counter() - start
+    conn.close()
+    return per_second(INSERT_RUNS, inserts), per_second(LOOKUP_RUNS, lookups)
+
+
+def main():
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 100000
+    with tempfile.TemporaryDirectory() as tmp:
+        print("SQLite %s; %d evidence; %d inserts (one transaction each), %d lookups"
+              % (sqlite3.sqlite_version, count, INSERT_RUNS, LOOKUP_RUNS))
+        print("%-58s %12s %12s" % ("settings", "inserts", "lookups"))
+        cases = [
+            ("rollback journal, synchronous=FULL, prepared per call", BASELINE_PRAGMAS, False),
+            ("rollback journal, synchronous=FULL, cached statements", BASELINE_PRAGMAS, True),
+            ("WAL, synchronous=NORMAL, prepared per call", CURRENT_PRAGMAS, False),
+            ("WAL, synchronous=NORMAL, cached statements (current)", CURRENT_PRAGMAS, True),
+        ]
+        for i, (name, pragmas, cached) in enumerate(cases):
+            # a fresh database each time, so that every case starts from the same data
+            path = os.path.join(tmp, "evidence-%d.sqlite" % i)
+            build_database(path, count)
+            print("%-58s %12s %12s" % ((name,) + measure(path, pragmas, cached, count)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,30 @@
+# dbbench seeds a throwaway evidence database and times the main evidence queries, using the
+# application's own DatabaseConnection. See bench/README.md
+
+QT       += core gui sql
+QT       -= widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Constants (used by DatabaseConnection) expects the build details that ashirt.pro provides
+DEFINES += "VERSION_TAG=\\\"v0.0.0-development\\\"" \
+           "COMMIT_HASH=\\\"Unknown\\\"" \
+           "SOURCE_CONTROL_REPO=\\\"\\\""
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    ../../src/db/databaseconnection.cpp \
+    ../../src/forms/evidence_filter/evidencefilter.cpp
+
+HEADERS += \
+    ../../src/db/databaseconnection.h \
+    ../../src/forms/evidence_filter/evidencefilter.h \
+    ../../src/helpers/perceptualhash.h
+
+RESOURCES += \
+    ../../res_migrations.qrc
@@ -0,0 +1,457 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+// dbbench measures the local database, through the application's own DatabaseConnection. It seeds
+// a throwaway evidence database (100,000 evidence by default), prints the query plan of each of the
+// main evidence queries, and then times:
+//   * filtered first pages, and paging further into the results (getEvidencePage)
+//   * finding similar captures (getSimilarEvidenceIDs), which compares every perceptual hash in an
+//     operation
+//   * the statement cache: statements prepared on every call vs. prepared once
+//   * inserts: the previous connection defaults (rollback journal, synchronous=FULL, statements
+//     prepared per call) vs. the current ones (WAL, synchronous=NORMAL, cached statements)
+//
+// The database is kept apart from the real one (via QStandardPaths' test mode), and removed after.
+//
+// Usage: dbbench [evidence-count]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "db/databaseconnection.h"
+#include "helpers/constants.h"
+#include "helpers/perceptualhash.h"
+
+static const int pageSize = 200;  // as read by EvidenceTableModel
+static const int queryRuns = 20;
+static const int cacheRuns = 1000;
+static const int insertRuns = 1000;
+
+// removeDatabase deletes the given database file, along with its journal and WAL files
+static void removeDatabase(const QString &path) {
+  for (const QString &suffix : {"", "-journal", "-wal", "-shm"}) {
+    QFile::remove(path + suffix);
+  }
+}
+
+// exec runs the given statement (with the given arguments) on the given connection
+static QSqlQuery exec(QSqlDatabase &conn, const QString &stmt,
+                      const std::vector<QVariant> &args = {}) {
+  QSqlQuery query(conn);
+  if (!query.prepare(stmt)) {
+    throw query.lastError();
+  }
+  for (const auto &arg : args) {
+    query.addBindValue(arg);
+  }
+  if (!query.exec()) {
+    throw query.lastError();
+  }
+  return query;
+}
+
+// medianMs runs fn the given number of times, and returns the median run time, in milliseconds
+static double medianMs(int runs, const std::function<void()> &fn) {
+  std::vector<double> times;
+  QElapsedTimer timer;
+  for (int i = 0; i < runs; i++) {
+    timer.start();
+    fn();
+    times.push_back(timer.nsecsElapsed() / 1e6);
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+// totalMs runs fn the given number of times, and returns the total run time, in milliseconds
+static double totalMs(int runs, const std::function<void()> &fn) {
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < runs; i++) {
+    fn();
+  }
+  return timer.nsecsElapsed() / 1e6;
+}
+
+// seed fills the (migrated) database with count evidence: 20 operations, a quarter of them
+// codeblocks, one capture every 5 minutes, 70% uploaded, 5% with an upload error (all unsubmitted),
+// 4% in burst series of 5 frames, and 2 tags each. Images have random (so, dissimilar) perceptual
+// hashes. This matches bench/dbbench/query_plans.sh.
+static void seed(QSqlDatabase &conn, int count) {
+  conn.transaction();
+  exec(conn,
+       "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < ?)"
+       " INSERT INTO evidence (path, operation_slug, content_type, description, error,"
+       "  recorded_date, upload_date, content_hash, series_id, perceptual_hash)"
+       " SELECT '/evidence/op' || (i % 20) || '/ashirt_screenshot_' || i || '.png',"
+       "  'op' || (i % 20),"
+       "  CASE WHEN i / 20 % 4 = 0 THEN 'codeblock' ELSE 'image' END,"
+       "  'capture ' || i,"
+       "  CASE WHEN i / 20 % 20 = 19 THEN 'Network error' ELSE '' END,"
+       "  datetime('2020-01-01', '+' || (i * 300) || ' seconds'),"
+       "  CASE WHEN i / 20 % 10 < 7"
+       "   THEN datetime('2020-01-01', '+' || (i * 300 + 60) || ' seconds') END,"
+       "  lower(hex(randomblob(32))),"
+       "  CASE WHEN i / 100 % 25 = 12 THEN i / 100 * 100 + i % 20 END,"
+       "  CASE WHEN i / 20 % 4 <> 0 THEN lower(hex(randomblob(128))) END"
+       " FROM n",
+       {count});
+  for (int offset : {1, 51}) {
+    exec(conn,
+         "INSERT INTO tags (evidence_id, tag_id, name)"
+         " SELECT id, id % 50 + ?, 'tag' || (id % 50 + ?) FROM evidence",
+         {offset, offset});
+  }
+  if (!conn.commit()) {
+    throw conn.lastError();
+  }
+}
+
+// taggedStatement wraps an evidence query as DatabaseConnection::getTaggedEvidence does
+static QString taggedStatement(const QString &evidenceQuery, const QString &order) {
+  return "SELECT e.*, t.id AS tag_row_id, t.tag_id AS tag_server_id, t.name AS tag_name"
+         " FROM (" + evidenceQuery + ") AS e"
+         " LEFT JOIN tags t ON t.evidence_id = e.id"
+         " ORDER BY " + order + ", t.id";
+}
+
+// pageStatement builds the statement DatabaseConnection::getEvidencePage runs for the given filter
+// query, sorted by sortKey (descending), and adds its arguments to args
+static QString pageStatement(QSqlDatabase &conn, const DBQuery &filterQuery,
+                             const QString &sortKey, qint64 afterID, std::vector<QVariant> &args) {
+  QString stmt = "SELECT *, " + sortKey + " AS sort_key FROM (" + filterQuery.query() + ")";
+  args = filterQuery.values();
+  if (afterID > 0) {
+    auto afterQuery = exec(conn, "SELECT " + sortKey + " FROM evidence WHERE id = ?", {afterID});
+    QVariant afterKey = afterQuery.first() ? afterQuery.value(0) : QVariant();
+    stmt += QString(" WHERE %1 < ? OR (%1 = ? AND id < ?)").arg(sortKey);
+    args.insert(args.end(), {afterKey, afterKey, afterID});
+  }
+  stmt += " ORDER BY sort_key DESC, id DESC LIMIT ?";
+  args.emplace_back(pageSize);
+  return taggedStatement(stmt, "e.sort_key DESC, e.id DESC");
+}
+
+// printPlan prints the EXPLAIN QUERY PLAN output for the given statement, as a tree
+static void printPlan(QSqlDatabase &conn, const QString &stmt,
+                      const std::vector<QVariant> &args = {}) {
+  auto query = exec(conn, "EXPLAIN QUERY PLAN " + stmt, args);
+  std::map<int, int> depths;
+  while (query.next()) {
+    int parent = query.value("parent").toInt();
+    int depth = (parent == 0) ? 0 : depths[parent] + 1;
+    depths[query.value("id").toInt()] = depth;
+    std::cout << "    " << std::string(size_t(depth) * 2, ' ')
+              << query.value("detail").toString().toStdString() << std::endl;
+  }
+}
+
+// FilterCase is a set of filters to measure, as they would be typed into the evidence manager
+struct FilterCase {
+  std::string name;
+  EvidenceFilters filters;
+};
+
+static std::vector<FilterCase> filterCases() {
+  EvidenceFilters none;
+  EvidenceFilters byOperation;
+  byOperation.operationSlug = "op3";
+  EvidenceFilters byType = byOperation;
+  byType.contentType = "codeblock";
+  EvidenceFilters byDate = byOperation;
+  byDate.startDate = QDate(2020, 6, 1);
+  byDate.endDate = QDate(2020, 6, 30);
+  EvidenceFilters byDateOnly;
+  byDateOnly.startDate = byDate.startDate;
+  byDateOnly.endDate = byDate.endDate;
+  EvidenceFilters unsubmitted = byOperation;
+  unsubmitted.submitted = Tri::No;
+  EvidenceFilters failed = byOperation;
+  failed.hasError = Tri::Yes;
+  EvidenceFilters bySeries = byOperation;
+  bySeries.seriesID = 1203;  // the first op3 series (see seed)
+
+  return {
+      {"(no filters)", none},
+      {"op:op3", byOperation},
+      {"op:op3 type:codeblock", byType},
+      {"op:op3 from:2020-06-01 to:2020-06-30", byDate},
+      {"from:2020-06-01 to:2020-06-30", byDateOnly},
+      {"op:op3 submitted:no", unsubmitted},
+      {"op:op3 err:yes", failed},
+      {"op:op3 series:1203", bySeries},
+  };
+}
+
+static void printPlans(DatabaseConnection &db, QSqlDatabase &conn,
+                       const std::vector<FilterCase> &cases, qint64 someID) {
+  std::cout << "== Query plans" << std::endl;
+  std::vector<QVariant> args;
+  for (const auto &c : cases) {
+    auto filterQuery = db.buildGetEvidenceWithFiltersQuery(c.filters);
+    std::cout << "  getEvidencePage: " << c.name << std::endl;
+    printPlan(conn, pageStatement(conn, filterQuery, "recorded_date", 0, args), args);
+    std::cout << "  getEvidencePage: " << c.name << " (later page)" << std::endl;
+    printPlan(conn, pageStatement(conn, filterQuery, "recorded_date", someID, args), args);
+  }
+  // other sort fields are not indexed: the matching evidence is read, then sorted
+  EvidenceFilters byOperation;
+  byOperation.operationSlug = "op3";
+  std::cout << "  getEvidencePage: op:op3, sorted by description" << std::endl;
+  printPlan(conn,
+            pageStatement(conn, db.buildGetEvidenceWithFiltersQuery(byOperation),
+                          "COALESCE(description, '')", someID, args),
+            args);
+
+  // the remaining statements mirror those in DatabaseConnection
+  QString columns =
+      "id, path, operation_slug, content_type, description, error, recorded_date, upload_date,"
+      " queued_date, upload_attempts, next_retry_date, content_hash, series_id, perceptual_hash";
+  std::cout << "  getEvidenceDetails" << std::endl;
+  printPlan(conn,
+            taggedStatement("SELECT " + columns + " FROM evidence WHERE id=? LIMIT 1", "e.id"),
+            {someID});
+  std::cout << "  getQueuedEvidence" << std::endl;
+  printPlan(conn, "SELECT " + columns +
+                      " FROM evidence INDEXED BY evidence_queued_idx"
+                      " WHERE queued_date IS NOT NULL AND upload_date IS NULL"
+                      " ORDER BY queued_date, id");
+  std::cout << "  findDuplicateEvidence" << std::endl;
+  printPlan(conn,
+            "SELECT " + columns +
+                " FROM evidence"
+                " WHERE content_hash=? AND operation_slug=? AND id<>?"
+                " ORDER BY (upload_date IS NULL AND queued_date IS NULL), id LIMIT 1",
+            {"0", "op3", someID});
+  std::cout << "  getSimilarEvidenceIDs" << std::endl;
+  printPlan(conn,
+            "SELECT id, perceptual_hash FROM evidence"
+            " WHERE operation_slug=? AND perceptual_hash IS NOT NULL",
+            {"op3"});
+  std::cout << "  getUnhashedImageEvidence (none left to hash)" << std::endl;
+  printPlan(conn,
+            "SELECT " + columns +
+                " FROM evidence"
+                " WHERE id>? AND content_type='image' AND perceptual_hash IS NULL"
+                " ORDER BY id LIMIT ?",
+            {0, 20});
+  std::cout << "  setEvidenceTags" << std::endl;
+  exec(conn, "CREATE TEMP TABLE IF NOT EXISTS tag_sync (tag_id INTEGER PRIMARY KEY, name TEXT)");
+  printPlan(conn,
+            "DELETE FROM tags WHERE evidence_id IN (?, ?)"
+            " AND tag_id NOT IN (SELECT tag_id FROM temp.tag_sync)",
+            {someID, someID + 1});
+  printPlan(conn,
+            "INSERT INTO tags (evidence_id, tag_id, name)"
+            " SELECT e.id, s.tag_id, s.name FROM evidence e CROSS JOIN temp.tag_sync s"
+            " WHERE e.id IN (?, ?) AND NOT EXISTS (SELECT 1 FROM tags t"
+            "  WHERE t.evidence_id = e.id AND t.tag_id = s.tag_id)",
+            {someID, someID + 1});
+  std::cout << "  deleteEvidence" << std::endl;
+  printPlan(conn, "DELETE FROM tags WHERE evidence_id IN (?, ?)", {someID, someID + 1});
+  std::cout << std::endl;
+}
+
+static void timePages(DatabaseConnection &db, const std::vector<FilterCase> &cases) {
+  std::cout << "== getEvidencePage (" << pageSize << " rows per page, median of " << queryRuns
+            << " runs, in ms)" << std::endl;
+  std::cout << "  " << std::left << std::setw(44) << "filters" << std::right << std::setw(12)
+            << "first page" << std::setw(12) << "later page" << std::setw(10) << "matches"
+            << std::endl;
+  for (const auto &c : cases) {
+    std::vector<model::Evidence> first;
+    double firstPage = medianMs(queryRuns, [&]() {
+      first = db.getEvidencePage(c.filters, SORT_RECORDED_DATE, Qt::DescendingOrder, 0, pageSize);
+    });
+    // page forward, one page per run, as scrolling through the evidence manager does (starting
+    // over from the first page once the results run out)
+    auto page = first;
+    double laterPage = medianMs(queryRuns, [&]() {
+      if (!page.empty()) {
+        page = db.getEvidencePage(c.filters, SORT_RECORDED_DATE, Qt::DescendingOrder,
+                                  page.back().id, pageSize);
+      }
+      if (page.empty()) {
+        page = first;
+      }
+    });
+    auto matches = db.getEvidenceIDsWithFilters(c.filters).size();
+    std::cout << "  " << std::left << std::setw(44) << c.name << std::right << std::setw(12)
+              << firstPage << std::setw(12) << laterPage << std::setw(10) << matches << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+static void timeSimilar(DatabaseConnection &db, qint64 imageID) {
+  std::vector<qint64> similar;
+  double ms = medianMs(queryRuns, [&]() {
+    similar = db.getSimilarEvidenceIDs(imageID, PerceptualHash::maxSimilarDistance);
+  });
+  EvidenceFilters bySimilar;
+  bySimilar.operationSlug = "op3";
+  bySimilar.similarTo = imageID;
+  double page = medianMs(queryRuns, [&]() {
+    db.getEvidencePage(bySimilar, SORT_RECORDED_DATE, Qt::DescendingOrder, 0, pageSize);
+  });
+  std::cout << "== Similar captures (median of " << queryRuns << " runs, in ms)" << std::endl;
+  std::cout << "  getSimilarEvidenceIDs (op:op3):          " << std::setw(10) << ms << "  ("
+            << similar.size() << " similar)" << std::endl;
+  std::cout << "  getEvidencePage (op:op3 similar:<id>):   " << std::setw(10) << page << std::endl;
+  std::cout << std::endl;
+}
+
+static void timeStatementCache(DatabaseConnection &db, QSqlDatabase &conn, int count) {
+  std::cout << "== Statement cache (" << cacheRuns << " calls each, in microseconds per call)"
+            << std::endl;
+  EvidenceFilters byOperation;
+  byOperation.operationSlug = "op3";
+  std::vector<QVariant> pageArgs;
+  QString pageStmt = pageStatement(conn, db.buildGetEvidenceWithFiltersQuery(byOperation),
+                                   "recorded_date", 0, pageArgs);
+  QString lookupStmt = taggedStatement("SELECT * FROM evidence WHERE id=? LIMIT 1", "e.id");
+
+  struct Case {
+    const char *name;
+    QString stmt;
+    std::function<std::vector<QVariant>(int)> args;
+  };
+  std::vector<Case> cases = {
+      {"getEvidenceDetails (one evidence)", lookupStmt,
+       [count](int i) { return std::vector<QVariant>{qint64(i * 7919 % count + 1)}; }},
+      {"getEvidencePage (op:op3, first page)", pageStmt,
+       [&pageArgs](int) { return pageArgs; }},
+  };
+  std::cout << "  " << std::left << std::setw(40) << "statement" << std::right << std::setw(14)
+            << "per call" << std::setw(14) << "once" << std::endl;
+  for (const auto &c : cases) {
+    int i = 0;
+    double perCall = totalMs(cacheRuns, [&]() {
+      auto query = exec(conn, c.stmt, c.args(i++));
+      while (query.next()) {
+      }
+    });
+    QSqlQuery cached(conn);
+    cached.prepare(c.stmt);
+    i = 0;
+    double once = totalMs(cacheRuns, [&]() {
+      cached.finish();
+      for (const auto &arg : c.args(i++)) {
+        cached.addBindValue(arg);
+      }
+      if (!cached.exec()) {
+        throw cached.lastError();
+      }
+      while (cached.next()) {
+      }
+    });
+    std::cout << "  " << std::left << std::setw(40) << c.name << std::right << std::setw(14)
+              << perCall * 1000 / cacheRuns << std::setw(14) << once * 1000 / cacheRuns
+              << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+static void timeInserts(DatabaseConnection &db, QSqlDatabase &conn) {
+  // the baseline database gets the same schema, but the previous connection defaults
+  QString baselinePath = Constants::dbLocation() + ".baseline";
+  removeDatabase(baselinePath);
+  {
+    auto baseline = QSqlDatabase::addDatabase("QSQLITE", "dbbench-baseline");
+    baseline.setDatabaseName(baselinePath);
+    if (!baseline.open()) {
+      throw baseline.lastError();
+    }
+    exec(baseline, "PRAGMA journal_mode=DELETE");
+    exec(baseline, "PRAGMA synchronous=FULL");
+    auto schema = exec(conn,
+                       "SELECT sql FROM sqlite_master"
+                       " WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite_%' ORDER BY rowid");
+    while (schema.next()) {
+      exec(baseline, schema.value(0).toString());
+    }
+
+    std::cout << "== Inserts (" << insertRuns << " captures, each in its own transaction)"
+              << std::endl;
+    double before = totalMs(insertRuns, [&baseline]() {
+      exec(baseline,
+           "INSERT INTO evidence (path, operation_slug, content_type, recorded_date)"
+           " VALUES (?, ?, ?, datetime('now'))",
+           {"/evidence/op3/bench.png", "op3", "image"});
+    });
+    double after = totalMs(insertRuns, [&db]() {
+      db.createEvidence("/evidence/op3/bench.png", "op3", "image");
+    });
+    std::cout << "  rollback journal, synchronous=FULL, prepared per call: " << std::setw(10)
+              << insertRuns * 1000 / before << " rows/s" << std::endl;
+    std::cout << "  WAL, synchronous=NORMAL, cached statement (current):   " << std::setw(10)
+              << insertRuns * 1000 / after << " rows/s" << std::endl;
+    baseline.close();
+  }
+  QSqlDatabase::removeDatabase("dbbench-baseline");
+  removeDatabase(baselinePath);
+}
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("ashirt-dbbench");
+  QStandardPaths::setTestModeEnabled(true);
+
+  int count = (argc > 1) ? QString(argv[1]).toInt() : 100000;
+  if (count < 1000) {
+    std::cerr << "Usage: dbbench [evidence-count (at least 1000)]" << std::endl;
+    return 1;
+  }
+  std::cout << std::fixed << std::setprecision(2);
+
+  QString dbPath = Constants::dbLocation();
+  removeDatabase(dbPath);
+  int rtn = 0;
+  {
+    DatabaseConnection db;
+    auto conn = QSqlDatabase::addDatabase("QSQLITE", "dbbench");
+    try {
+      db.connect();
+      conn.setDatabaseName(dbPath);
+      if (!conn.open()) {
+        throw conn.lastError();
+      }
+      QElapsedTimer timer;
+      timer.start();
+      seed(conn, count);
+      auto version = exec(conn, "SELECT sqlite_version()");
+      version.next();
+      std::cout << "SQLite " << version.value(0).toString().toStdString() << "; seeded " << count
+                << " evidence (" << count * 2 << " tags) in " << timer.elapsed() << " ms"
+                << std::endl
+                << std::endl;
+
+      qint64 someID = count / 40 * 20 + 3;  // an evidence in op3
+      auto cases = filterCases();
+      printPlans(db, conn, cases, someID);
+      timePages(db, cases);
+      timeSimilar(db, someID + 20);  // someID is a codeblock; this is the next op3 image
+      timeStatementCache(db, conn, count);
+      timeInserts(db, conn);
+    }
+    catch (QSqlError &e) {
+      std::cerr << "Database error: " << e.text().toStdString() << std::endl;
+      rtn = 1;
+    }
+    conn.close();
+    db.close();
+  }
+  QSqlDatabase::removeDatabase("dbbench");
+  removeDatabase(dbPath);
+  return rtn;
+}
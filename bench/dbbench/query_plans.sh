@@ -0,0 +1,152 @@
+#! /usr/bin/env bash
+
+# Builds a synthetic evidence database (by applying the migrations, then seeding it), and prints the
+# query plan and run time of each of the main evidence queries. This needs only the sqlite3 CLI, so
+# it can be used to check the effect of a schema change without building the application. The
+# statements below mirror the SQL built by DatabaseConnection; dbbench runs the real thing.
+#
+# Usage: bench/dbbench/query_plans.sh [evidence-count]   (default: 100000)
+
+# exit on error
+set -e
+
+# set cwd to project root
+cd "$(dirname "$0")/../.."
+
+count=${1:-100000}
+dbPath=$(mktemp -d)/evidence.sqlite
+trap 'rm -rf "$(dirname "$dbPath")"' EXIT
+
+# apply each migration's Up section, in order (as DatabaseConnection::migrateDB does)
+for migration in migrations/*.sql; do
+  awk '/-- \+migrate Up/ { up = 1; next } /-- \+migrate Down/ { up = 0 } up' "$migration" \
+    | sqlite3 "$dbPath"
+done
+
+# 20 operations, a quarter of them codeblocks, one capture every 5 minutes, 70% uploaded, 5% with
+# an upload error (all unsubmitted), 4% in burst series of 5 frames, and 2 tags each (from a pool of
+# 100). The type, upload and error columns follow (i / 20), so that they vary within each operation.
+# A series is identified by the ID of its first frame, as createEvidenceSeries does. Images have
+# random (so, dissimilar) perceptual hashes.
+sqlite3 "$dbPath" >/dev/null <<SQL
+PRAGMA journal_mode=WAL;
+BEGIN;
+WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < $count)
+INSERT INTO evidence (path, operation_slug, content_type, description, error, recorded_date,
+                      upload_date, content_hash, series_id, perceptual_hash)
+SELECT '/evidence/op' || (i % 20) || '/ashirt_screenshot_' || i || '.png',
+       'op' || (i % 20),
+       CASE WHEN i / 20 % 4 = 0 THEN 'codeblock' ELSE 'image' END,
+       'capture ' || i,
+       CASE WHEN i / 20 % 20 = 19 THEN 'Network error' ELSE '' END,
+       datetime('2020-01-01', '+' || (i * 300) || ' seconds'),
+       CASE WHEN i / 20 % 10 < 7 THEN datetime('2020-01-01', '+' || (i * 300 + 60) || ' seconds') END,
+       lower(hex(randomblob(32))),
+       CASE WHEN i / 100 % 25 = 12 THEN i / 100 * 100 + i % 20 END,
+       CASE WHEN i / 20 % 4 <> 0 THEN lower(hex(randomblob(128))) END
+FROM n;
+INSERT INTO tags (evidence_id, tag_id, name) SELECT id, id % 50 + 1, 'tag' || (id % 50 + 1) FROM evidence;
+INSERT INTO tags (evidence_id, tag_id, name) SELECT id, id % 50 + 51, 'tag' || (id % 50 + 51) FROM evidence;
+COMMIT;
+SQL
+
+# columns and shapes as built by DatabaseConnection (evidenceColumns, getTaggedEvidence, etc). The
+# staged tags (temp.tag_sync) are inlined, since each statement runs in its own sqlite3 process.
+cols="id, path, operation_slug, content_type, description, error, recorded_date, upload_date,
+  queued_date, upload_attempts, next_retry_date, content_hash, series_id, perceptual_hash"
+tagged() {  # tagged <evidence query> <order>: wraps a query as getTaggedEvidence does
+  echo "SELECT e.*, t.id AS tag_row_id, t.tag_id AS tag_server_id, t.name AS tag_name
+  FROM ($1) AS e LEFT JOIN tags t ON t.evidence_id = e.id ORDER BY $2, t.id"
+}
+page() {  # page <filter query> <after id> [sort key]: a getEvidencePage query, descending, 200 rows
+  local key=${3:-recorded_date}
+  local stmt="SELECT *, $key AS sort_key FROM ($1)"
+  if [ "$2" -gt 0 ]; then
+    local after  # read up front, and quoted as a literal, as getEvidencePage binds it
+    after=$(sqlite3 "$dbPath" "SELECT quote($key) FROM evidence WHERE id = $2")
+    stmt="$stmt WHERE $key < $after OR ($key = $after AND id < $2)"
+  fi
+  tagged "$stmt ORDER BY sort_key DESC, id DESC LIMIT 200" "e.sort_key DESC, e.id DESC"
+}
+
+# queries are labelled as: <DatabaseConnection method>: <filter / purpose>
+queries=(
+  "getEvidencePage: operation:op3 (first page)"
+  "$(page "SELECT $cols FROM evidence WHERE operation_slug = 'op3'" 0)"
+
+  "getEvidencePage: operation:op3 (page after id 50003)"
+  "$(page "SELECT $cols FROM evidence WHERE operation_slug = 'op3'" 50003)"
+
+  "getEvidencePage: operation:op3 type:codeblock"
+  "$(page "SELECT $cols FROM evidence
+    WHERE operation_slug = 'op3' AND content_type = 'codeblock'" 0)"
+
+  "getEvidencePage: operation:op3 from:2020-06-01 to:2020-06-30"
+  "$(page "SELECT $cols FROM evidence WHERE operation_slug = 'op3'
+    AND recorded_date >= '2020-06-01' AND recorded_date < '2020-07-01'" 0)"
+
+  "getEvidencePage: from:2020-06-01 to:2020-06-30"
+  "$(page "SELECT $cols FROM evidence
+    WHERE recorded_date >= '2020-06-01' AND recorded_date < '2020-07-01'" 0)"
+
+  "getEvidencePage: operation:op3 submitted:no"
+  "$(page "SELECT $cols FROM evidence WHERE upload_date IS NULL AND operation_slug = 'op3'" 0)"
+
+  "getEvidencePage: operation:op3 error:yes"
+  "$(page "SELECT $cols FROM evidence WHERE error LIKE '_%' AND operation_slug = 'op3'" 0)"
+
+  "getEvidencePage: operation:op3 series:1203"
+  "$(page "SELECT $cols FROM evidence WHERE operation_slug = 'op3' AND series_id = 1203" 0)"
+
+  "getEvidencePage: operation:op3, sorted by description"
+  "$(page "SELECT $cols FROM evidence WHERE operation_slug = 'op3'" 50003 \
+    "COALESCE(description, '')")"
+
+  "getEvidencePage: (no filters)"
+  "$(page "SELECT $cols FROM evidence" 0)"
+
+  "getEvidenceDetails: one evidence, with tags"
+  "$(tagged "SELECT $cols FROM evidence WHERE id = 50003 LIMIT 1" "e.id")"
+
+  "getQueuedEvidence"
+  "SELECT $cols FROM evidence INDEXED BY evidence_queued_idx
+    WHERE queued_date IS NOT NULL AND upload_date IS NULL ORDER BY queued_date, id"
+
+  "findDuplicateEvidence"
+  "SELECT $cols FROM evidence WHERE content_hash = 'abc' AND operation_slug = 'op3' AND id <> 1
+    ORDER BY (upload_date IS NULL AND queued_date IS NULL), id LIMIT 1"
+
+  "getSimilarEvidenceIDs: hashes to compare"
+  "SELECT id, perceptual_hash FROM evidence
+    WHERE operation_slug = 'op3' AND perceptual_hash IS NOT NULL"
+
+  "getUnhashedImageEvidence: none left to hash"
+  "SELECT $cols FROM evidence
+    WHERE id > 0 AND content_type = 'image' AND perceptual_hash IS NULL ORDER BY id LIMIT 20"
+
+  "setEvidenceTags: remove tags no longer applied"
+  "DELETE FROM tags WHERE evidence_id IN (50003, 50004)
+    AND tag_id NOT IN (SELECT tag_id FROM (SELECT 7 AS tag_id))"
+
+  "setEvidenceTags: add new tags"
+  "INSERT INTO tags (evidence_id, tag_id, name)
+    SELECT e.id, s.tag_id, s.name FROM evidence e CROSS JOIN (SELECT 7 AS tag_id, 'tag7' AS name) s
+    WHERE e.id IN (50003, 50004) AND NOT EXISTS (SELECT 1 FROM tags t
+      WHERE t.evidence_id = e.id AND t.tag_id = s.tag_id)"
+
+  "deleteEvidence: remove tags"
+  "DELETE FROM tags WHERE evidence_id IN (50003, 50004)"
+)
+
+echo "SQLite $(sqlite3 --version | cut -d' ' -f1); $count evidence, $(sqlite3 "$dbPath" \
+  'SELECT COUNT(*) FROM tags') tags"
+for ((i = 0; i < ${#queries[@]}; i += 2)); do
+  echo
+  echo "== ${queries[i]}"
+  sqlite3 "$dbPath" "EXPLAIN QUERY PLAN ${queries[i + 1]}"
+  # best of 5 runs; writes are rolled back, so that every query sees the same data
+  for run in 1 2 3 4 5; do
+    printf 'BEGIN;\n.timer on\n%s;\n.timer off\nROLLBACK;\n' "${queries[i + 1]}" \
+      | sqlite3 "$dbPath" | sed -n 's/^Run Time: real \([0-9.]*\).*/\1/p'
+  done | sort -n | head -1 | awk '{ print "run time: " ($1 < 0.001 ? "< 1" : $1 * 1000) " ms" }'
+done
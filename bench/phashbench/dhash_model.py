@@ -0,0 +1,135 @@
+#! /usr/bin/env python3
+
+# Runs phashbench's synthetic corpus through a Python model of PerceptualHash::dHash, using PyQt5,
+# so that the hash size and maxSimilarDistance can be checked without a C++ Qt toolchain. Screens
+# are drawn with QPainter, and reduced with QImage's smooth scaling, as phashbench and the
+# application do; only the hash's bit packing (and the random number generator, and so the exact
+# corpus) differ. Hashing times are not modelled; phashbench measures them.
+#
+# Usage: QT_QPA_PLATFORM=offscreen bench/phashbench/dhash_model.py [screen-count] [COLSxROWS]
+#          [max-similar-distance]
+#   (defaults: 200 screens, and PerceptualHash's 32x32 comparisons and maxSimilarDistance; e.g.
+#   "200 8x8 10" models the common 64 bit dHash, with a 10 bit threshold)
+
+import random
+import sys
+
+from PyQt5.QtCore import QBuffer, QByteArray, QIODevice, QRect, Qt
+from PyQt5.QtGui import QColor, QFont, QGuiApplication, QImage, QPainter
+
+MAX_SIMILAR_DISTANCE = 48  # PerceptualHash::maxSimilarDistance
+
+WIDTH, HEIGHT = 1920, 1080
+LINE_COUNT = 48
+
+WORDS = ["ls", "-la", "cd", "/var/log", "grep", "ERROR", "sudo", "nmap", "-sV", "10.0.", "0.1",
+         "curl", "-k", "https://", "admin", "200", "OK", "tcp", "open", "ssh", "http",
+         "drwxr-xr-x", "root", "443", "denied", "cat", "/etc/hosts", "python3", "exploit.py",
+         "--target", "done", "|"]
+
+
+def random_line(rng):
+    return "".join(rng.choice(WORDS) + " " for _ in range(rng.randrange(14)))
+
+
+def random_screen(rng):
+    return {
+        "lines": [random_line(rng) for _ in range(LINE_COUNT)],
+        "clock": "%02d:%02d:%02d" % (rng.randrange(24), rng.randrange(60), rng.randrange(60)),
+        "cursor_line": LINE_COUNT - 1,
+    }
+
+
+def render(screen):
+    """Draws the given screen as phashbench does: a terminal, with a clock in its title bar"""
+    image = QImage(WIDTH, HEIGHT, QImage.Format_RGB32)
+    image.fill(QColor(30, 30, 30))
+    painter = QPainter(image)
+    font = QFont("monospace")
+    font.setStyleHint(QFont.Monospace)
+    font.setPixelSize(18)
+    painter.setFont(font)
+    line_height = (HEIGHT - 40) // LINE_COUNT
+
+    painter.fillRect(0, 0, WIDTH, 30, QColor(60, 60, 60))
+    painter.setPen(QColor(220, 220, 220))
+    painter.drawText(QRect(WIDTH - 120, 0, 110, 30), Qt.AlignVCenter, screen["clock"])
+
+    painter.setPen(QColor(200, 255, 200))
+    for i, line in enumerate(screen["lines"]):
+        painter.drawText(10, 40 + (i + 1) * line_height, "$ " + line)
+    painter.fillRect(10, 40 + screen["cursor_line"] * line_height + 4, 10, line_height, Qt.white)
+    painter.end()
+    return image
+
+
+def recompressed(image):
+    data = QByteArray()
+    buffer = QBuffer(data)
+    buffer.open(QIODevice.WriteOnly)
+    image.save(buffer, "JPG", 60)
+    return QImage.fromData(data, "JPG")
+
+
+def dhash(image, columns, rows):
+    """Models PerceptualHash::dHash, as an integer of columns * rows bits"""
+    small = image.scaled(columns + 1, rows, Qt.IgnoreAspectRatio, Qt.SmoothTransformation) \
+        .convertToFormat(QImage.Format_Grayscale8)
+    bits = 0
+    for y in range(rows):
+        line = small.constScanLine(y)
+        line.setsize(columns + 1)
+        row = bytes(line)
+        for x in range(columns):
+            if row[x] < row[x + 1]:
+                bits |= 1 << (y * columns + x)
+    return bits
+
+
+def distance(a, b):
+    return bin(a ^ b).count("1")
+
+
+def main():
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+    columns, rows = map(int, (sys.argv[2] if len(sys.argv) > 2 else "32x32").split("x"))
+    max_similar = int(sys.argv[3]) if len(sys.argv) > 3 else MAX_SIMILAR_DISTANCE
+    app = QGuiApplication(sys.argv[:1])  # needed to render text
+
+    rng = random.Random(1234)
+    names = ["clock changed", "cursor moved", "recompressed (JPEG, quality 60)",
+             "downscaled (half size)", "one more line (screen scrolled)", "different screens"]
+    distances = {name: [] for name in names}
+    hashes = []
+    # each screen is compared with its variants as it is generated, so that only the hashes (and
+    # not every image) are kept
+    for i in range(count):
+        screen = random_screen(rng)
+        image = render(screen)
+        hashes.append(dhash(image, columns, rows))
+        scrolled = dict(screen, lines=screen["lines"][1:] + [random_line(rng)])
+        variants = [
+            render(dict(screen, clock="00:00:00")),
+            render(dict(screen, cursor_line=i % (LINE_COUNT - 1))),
+            recompressed(image),
+            image.scaled(WIDTH // 2, HEIGHT // 2, Qt.KeepAspectRatio, Qt.SmoothTransformation),
+            render(scrolled),
+        ]
+        for name, variant in zip(names, variants):
+            distances[name].append(distance(hashes[-1], dhash(variant, columns, rows)))
+    for i in range(count):
+        for j in range(i + 1, count):
+            distances["different screens"].append(distance(hashes[i], hashes[j]))
+
+    print("%d synthetic %dx%d screens; %dx%d comparisons (%d bits); similar: at most %d differ"
+          % (count, WIDTH, HEIGHT, columns, rows, columns * rows, max_similar))
+    print("  %-36s %8s %9s %7s %7s %7s" % ("pairs", "count", "similar", "min", "median", "max"))
+    for name in names:
+        values = sorted(distances[name])
+        similar = sum(1 for value in values if value <= max_similar)
+        print("  %-36s %8d %9d %7d %7d %7d" % (name, len(values), similar, values[0],
+                                               values[len(values) // 2], values[-1]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,252 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+// phashbench measures perceptual hashing (see PerceptualHash): how long hashing takes, and how
+// well the hash separates near-duplicate captures from different ones.
+//
+// Given a directory, every image in it is hashed, and each pair of images that would be reported as
+// similar (i.e. within PerceptualHash::maxSimilarDistance) is listed, so that the threshold can be
+// checked against real captures. Otherwise, a synthetic corpus is generated: terminal-like screens,
+// each with variants that should be reported as similar (a changed clock, a moved cursor, a
+// recompressed or downscaled copy), and one that is reported separately (one more line of output,
+// which scrolls the whole screen).
+//
+// Text is rendered with QPainter, so this needs a platform plugin; on a headless machine, run with
+// "-platform offscreen".
+//
+// Usage: phashbench [image-directory]
+
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "helpers/perceptualhash.h"
+
+static const int screenCount = 200;
+static const int screenWidth = 1920;
+static const int screenHeight = 1080;
+static const int lineCount = 48;
+
+/// Screen describes a synthetic terminal-like capture
+struct Screen {
+  std::vector<QString> lines;
+  QString clock;
+  int cursorLine;
+};
+
+static QString randomLine(QRandomGenerator &rng) {
+  static const std::vector<QString> words = {
+      "ls",     "-la",   "cd",       "/var/log", "grep",   "ERROR",   "sudo",  "nmap",
+      "-sV",    "10.0.", "0.1",      "curl",     "-k",     "https://", "admin", "200",
+      "OK",     "tcp",   "open",     "ssh",      "http",   "drwxr-xr-x", "root", "443",
+      "denied", "cat",   "/etc/hosts", "python3", "exploit.py", "--target", "done", "|"};
+  QString line;
+  int wordCount = rng.bounded(0, 14);
+  for (int i = 0; i < wordCount; i++) {
+    line += words[size_t(rng.bounded(int(words.size())))] + " ";
+  }
+  return line;
+}
+
+static Screen randomScreen(QRandomGenerator &rng) {
+  Screen screen;
+  for (int i = 0; i < lineCount; i++) {
+    screen.lines.push_back(randomLine(rng));
+  }
+  screen.clock = QString("%1:%2:%3")
+                     .arg(rng.bounded(24), 2, 10, QChar('0'))
+                     .arg(rng.bounded(60), 2, 10, QChar('0'))
+                     .arg(rng.bounded(60), 2, 10, QChar('0'));
+  screen.cursorLine = lineCount - 1;
+  return screen;
+}
+
+static QImage render(const Screen &screen) {
+  QImage image(screenWidth, screenHeight, QImage::Format_RGB32);
+  image.fill(QColor(30, 30, 30));
+  QPainter painter(&image);
+  QFont font("monospace");
+  font.setStyleHint(QFont::Monospace);
+  font.setPixelSize(18);
+  painter.setFont(font);
+  int lineHeight = (screenHeight - 40) / lineCount;
+
+  // title bar, with a clock
+  painter.fillRect(0, 0, screenWidth, 30, QColor(60, 60, 60));
+  painter.setPen(QColor(220, 220, 220));
+  painter.drawText(QRect(screenWidth - 120, 0, 110, 30), Qt::AlignVCenter, screen.clock);
+
+  painter.setPen(QColor(200, 255, 200));
+  for (size_t i = 0; i < screen.lines.size(); i++) {
+    painter.drawText(10, 40 + int(i + 1) * lineHeight, "$ " + screen.lines[i]);
+  }
+  painter.fillRect(10, 40 + screen.cursorLine * lineHeight + 4, 10, lineHeight, Qt::white);
+  return image;
+}
+
+static QImage recompressed(const QImage &image) {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  image.save(&buffer, "JPG", 60);
+  return QImage::fromData(buffer.data(), "JPG");
+}
+
+/// Distances collects the distances between a kind of image pair
+struct Distances {
+  std::string name;
+  std::vector<int> values;
+};
+
+static void printDistances(const std::vector<Distances> &rows) {
+  std::cout << "  " << std::left << std::setw(36) << "pairs" << std::right << std::setw(8)
+            << "count" << std::setw(10) << "similar" << std::setw(8) << "min" << std::setw(8)
+            << "median" << std::setw(8) << "max" << std::endl;
+  for (auto row : rows) {
+    std::sort(row.values.begin(), row.values.end());
+    auto similar = std::count_if(row.values.begin(), row.values.end(), [](int distance) {
+      return distance <= PerceptualHash::maxSimilarDistance;
+    });
+    std::cout << "  " << std::left << std::setw(36) << row.name << std::right << std::setw(8)
+              << row.values.size() << std::setw(10) << similar << std::setw(8)
+              << row.values.front() << std::setw(8) << row.values[row.values.size() / 2]
+              << std::setw(8) << row.values.back() << std::endl;
+  }
+}
+
+static void benchSynthetic() {
+  QRandomGenerator rng(1234);  // the same corpus every run
+  std::vector<QString> hashes;
+  std::vector<double> hashTimes;
+  std::vector<double> decodeTimes;
+  std::vector<Distances> rows = {
+      {"clock changed", {}},
+      {"cursor moved", {}},
+      {"recompressed (JPEG, quality 60)", {}},
+      {"downscaled (half size)", {}},
+      {"one more line (screen scrolled)", {}},
+      {"different screens", {}},
+  };
+
+  // each screen is compared with its variants as it is generated, so that only the hashes (and not
+  // every image) are kept
+  QElapsedTimer timer;
+  for (int i = 0; i < screenCount; i++) {
+    Screen screen = randomScreen(rng);
+    QImage image = render(screen);
+    timer.start();
+    hashes.push_back(PerceptualHash::dHash(image));
+    hashTimes.push_back(timer.nsecsElapsed() / 1e6);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    timer.start();
+    PerceptualHash::dHash(QImage::fromData(buffer.data(), "PNG"));
+    decodeTimes.push_back(timer.nsecsElapsed() / 1e6);
+
+    Screen clock = screen;
+    clock.clock = "00:00:00";
+    Screen cursor = screen;
+    cursor.cursorLine = i % (lineCount - 1);
+    Screen scrolled = screen;
+    scrolled.lines.erase(scrolled.lines.begin());
+    scrolled.lines.push_back(randomLine(rng));
+
+    std::vector<QImage> variants = {
+        render(clock), render(cursor), recompressed(image),
+        image.scaled(screenWidth / 2, screenHeight / 2, Qt::KeepAspectRatio,
+                     Qt::SmoothTransformation),
+        render(scrolled)};
+    for (size_t v = 0; v < variants.size(); v++) {
+      rows[v].values.push_back(
+          PerceptualHash::distance(hashes.back(), PerceptualHash::dHash(variants[v])));
+    }
+  }
+  for (size_t i = 0; i < hashes.size(); i++) {
+    for (size_t j = i + 1; j < hashes.size(); j++) {
+      rows.back().values.push_back(PerceptualHash::distance(hashes[i], hashes[j]));
+    }
+  }
+
+  std::sort(hashTimes.begin(), hashTimes.end());
+  std::sort(decodeTimes.begin(), decodeTimes.end());
+  std::cout << "== Hashing (" << screenCount << " synthetic " << screenWidth << "x"
+            << screenHeight << " screens)" << std::endl;
+  std::cout << "  dHash:                  " << hashTimes[hashTimes.size() / 2]
+            << " ms per image (median)" << std::endl;
+  std::cout << "  PNG decode, then dHash: " << decodeTimes[decodeTimes.size() / 2]
+            << " ms per image (median)" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "== Distances (of " << PerceptualHash::hashColumns * PerceptualHash::hashRows
+            << " bits; similar: at most " << PerceptualHash::maxSimilarDistance << " differ)"
+            << std::endl;
+  printDistances(rows);
+}
+
+static void benchDirectory(const QString &path) {
+  QDir dir(path);
+  auto files = dir.entryInfoList({"*.png", "*.jpg", "*.jpeg", "*.webp", "*.bmp"}, QDir::Files,
+                                 QDir::Name);
+  std::vector<QString> names;
+  std::vector<QString> hashes;
+  std::vector<double> times;
+  QElapsedTimer timer;
+  for (const auto &file : files) {
+    timer.start();
+    auto hash = PerceptualHash::dHashFile(file.filePath());
+    times.push_back(timer.nsecsElapsed() / 1e6);
+    if (hash.isEmpty()) {
+      std::cout << "Skipping " << file.fileName().toStdString() << " (not readable as an image)"
+                << std::endl;
+      continue;
+    }
+    names.push_back(file.fileName());
+    hashes.push_back(hash);
+  }
+  if (hashes.size() < 2) {
+    std::cerr << "Need at least 2 images in " << path.toStdString() << std::endl;
+    return;
+  }
+  std::sort(times.begin(), times.end());
+  std::cout << "== Hashing (" << hashes.size() << " images)" << std::endl;
+  std::cout << "  decode, then dHash: " << times[times.size() / 2] << " ms per image (median), "
+            << times.back() << " ms at most" << std::endl
+            << std::endl;
+
+  std::cout << "== Similar pairs (at most " << PerceptualHash::maxSimilarDistance
+            << " bits differ)" << std::endl;
+  Distances all{"all pairs", {}};
+  for (size_t i = 0; i < hashes.size(); i++) {
+    for (size_t j = i + 1; j < hashes.size(); j++) {
+      int distance = PerceptualHash::distance(hashes[i], hashes[j]);
+      all.values.push_back(distance);
+      if (distance <= PerceptualHash::maxSimilarDistance) {
+        std::cout << "  " << std::setw(4) << distance << "  " << names[i].toStdString() << "  "
+                  << names[j].toStdString() << std::endl;
+      }
+    }
+  }
+  std::cout << std::endl;
+  printDistances({all});
+}
+
+int main(int argc, char *argv[]) {
+  QGuiApplication app(argc, argv);
+  std::cout << std::fixed << std::setprecision(2);
+  if (argc > 1) {
+    benchDirectory(QString(argv[1]));
+  }
+  else {
+    benchSynthetic();
+  }
+  return 0;
+}
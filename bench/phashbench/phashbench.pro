@@ -0,0 +1,18 @@
+# phashbench measures perceptual hashing (see PerceptualHash) over a corpus of images. See
+# bench/README.md
+
+QT       += core gui
+QT       -= widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../../src/helpers/perceptualhash.h
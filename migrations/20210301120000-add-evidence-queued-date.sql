@@ -0,0 +1,5 @@
+-- +migrate Up
+ALTER TABLE evidence ADD COLUMN queued_date TIMESTAMP;
+
+-- +migrate Down
+-- cannot do a proper migrate down (SQLite does not support ALTER TABLE DROP COLUMN)
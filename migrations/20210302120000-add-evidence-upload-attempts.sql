@@ -0,0 +1,5 @@
+-- +migrate Up
+ALTER TABLE evidence ADD COLUMN upload_attempts INTEGER NOT NULL DEFAULT 0;
+
+-- +migrate Down
+-- cannot do a proper migrate down (SQLite does not support ALTER TABLE DROP COLUMN)
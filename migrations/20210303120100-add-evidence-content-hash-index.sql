@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_content_hash_idx ON evidence (content_hash, operation_slug);
+
+-- +migrate Down
+DROP INDEX evidence_content_hash_idx;
@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_operation_recorded_idx ON evidence (operation_slug, recorded_date);
+
+-- +migrate Down
+DROP INDEX evidence_operation_recorded_idx;
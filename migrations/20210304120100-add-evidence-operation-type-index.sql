@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_operation_type_idx ON evidence (operation_slug, content_type, recorded_date);
+
+-- +migrate Down
+DROP INDEX evidence_operation_type_idx;
@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_upload_date_idx ON evidence (upload_date, operation_slug);
+
+-- +migrate Down
+DROP INDEX evidence_upload_date_idx;
@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_queued_idx ON evidence (queued_date, id) WHERE queued_date IS NOT NULL AND upload_date IS NULL;
+
+-- +migrate Down
+DROP INDEX evidence_queued_idx;
@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX tags_evidence_idx ON tags (evidence_id, tag_id, name);
+
+-- +migrate Down
+DROP INDEX tags_evidence_idx;
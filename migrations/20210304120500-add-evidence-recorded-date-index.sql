@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_recorded_idx ON evidence (recorded_date);
+
+-- +migrate Down
+DROP INDEX evidence_recorded_idx;
@@ -0,0 +1,5 @@
+-- +migrate Up
+DELETE FROM tags WHERE evidence_id NOT IN (SELECT id FROM evidence);
+
+-- +migrate Down
+-- orphaned tags are not restored
@@ -0,0 +1,5 @@
+-- +migrate Up
+CREATE INDEX evidence_series_idx ON evidence (series_id, operation_slug, recorded_date);
+
+-- +migrate Down
+DROP INDEX evidence_series_idx;
@@ -0,0 +1,7 @@
+-- +migrate Up
+-- hashes from the earlier 64 bit dHash cannot be compared to the current 1024 bit hashes; clearing
+-- them lets the application recompute them (see TrayManager::backfillPerceptualHashes)
+UPDATE evidence SET perceptual_hash = NULL WHERE length(perceptual_hash) <> 256;
+
+-- +migrate Down
+-- cleared hashes are recomputed, not restored
@@ -37,6 +37,19 @@ class AppConfig {
   QString captureWindowExec = "";
   QString captureWindowShortcut = "";
   QString captureCodeblockShortcut = "";
+  QString captureBurstShortcut = "";
+  int maxConcurrentUploads = 2;
+  int maxUploadAttempts = 8;
+  int uploadRateLimit = 0;
+  bool logRequestTiming = false;
+  int captureTimeoutSecs = 120;
+  bool builtInCapture = false;
+  QString captureFormat = "png";
+  int captureQuality = -1;
+  bool downscaleHiDPICaptures = false;
+  int burstFrameCount = 10;
+  int burstIntervalMs = 500;
+  int burstBufferFrames = 8;
 
   QString errorText = "";
 
@@ -90,6 +103,20 @@ class AppConfig {
     this->captureWindowExec = doc["captureWindowExec"].toString();
     this->captureWindowShortcut = doc["captureWindowShortcut"].toString();
     this->captureCodeblockShortcut = doc["captureCodeblockShortcut"].toString();
+    this->captureBurstShortcut = doc["captureBurstShortcut"].toString();
+    this->maxConcurrentUploads = doc["maxConcurrentUploads"].toInt(maxConcurrentUploads);
+    this->maxUploadAttempts = doc["maxUploadAttempts"].toInt(maxUploadAttempts);
+    this->uploadRateLimit = doc["uploadRateLimit"].toInt(uploadRateLimit);
+    this->logRequestTiming = doc["logRequestTiming"].toBool(logRequestTiming);
+    this->captureTimeoutSecs = doc["captureTimeoutSeconds"].toInt(captureTimeoutSecs);
+    // configs from before the built-in backend keep using their capture command, if they set one
+    this->builtInCapture = doc["builtInCapture"].toBool(screenshotExec.isEmpty());
+    this->captureFormat = doc["captureFormat"].toString(captureFormat);
+    this->captureQuality = doc["captureQuality"].toInt(captureQuality);
+    this->downscaleHiDPICaptures = doc["downscaleHiDPICaptures"].toBool(downscaleHiDPICaptures);
+    this->burstFrameCount = doc["burstFrameCount"].toInt(burstFrameCount);
+    this->burstIntervalMs = doc["burstIntervalMs"].toInt(burstIntervalMs);
+    this->burstBufferFrames = doc["burstBufferFrames"].toInt(burstBufferFrames);
   }
 
   void writeDefaultConfig() {
@@ -99,6 +126,7 @@ class AppConfig {
     screenshotExec = "screencapture -s %file";
     captureWindowExec = "screencapture -w %file";
 #endif
+    builtInCapture = screenshotExec.isEmpty();
 
     try {
       writeConfig();
@@ -120,6 +148,19 @@ class AppConfig {
     root["captureWindowExec"] = captureWindowExec;
     root["captureWindowShortcut"] = captureWindowShortcut;
     root["captureCodeblockShortcut"] = captureCodeblockShortcut;
+    root["captureBurstShortcut"] = captureBurstShortcut;
+    root["maxConcurrentUploads"] = maxConcurrentUploads;
+    root["maxUploadAttempts"] = maxUploadAttempts;
+    root["uploadRateLimit"] = uploadRateLimit;
+    root["logRequestTiming"] = logRequestTiming;
+    root["captureTimeoutSeconds"] = captureTimeoutSecs;
+    root["builtInCapture"] = builtInCapture;
+    root["captureFormat"] = captureFormat;
+    root["captureQuality"] = captureQuality;
+    root["downscaleHiDPICaptures"] = downscaleHiDPICaptures;
+    root["burstFrameCount"] = burstFrameCount;
+    root["burstIntervalMs"] = burstIntervalMs;
+    root["burstBufferFrames"] = burstBufferFrames;
 
     auto saveRoot = saveLocation.left(saveLocation.lastIndexOf("/"));
     QDir().mkpath(saveRoot);
@@ -7,6 +7,7 @@
 #include <QSettings>
 #include <QString>
 
+#include "dtos/operation.h"
 #include "models/tag.h"
 
 // AppSettings is a singleton construct for accessing the application's settings. This is different
@@ -32,6 +33,8 @@ class AppSettings : public QObject {
   const char *opSlugSetting = "operation/slug";
   const char *opNameSetting = "operation/name";
   const char *lastUsedTagsSetting = "gather/tags";
+  const char *cachedOperationsSetting = "operation/cached_list";
+  const char *offlineModeSetting = "network/offline";
 
   AppSettings() : QObject(nullptr) {}
 
@@ -62,5 +65,29 @@ class AppSettings : public QObject {
     auto val = settings.value(lastUsedTagsSetting);
     return qvariant_cast<std::vector<model::Tag>>(val);
   }
+
+  /// setCachedOperations records the last known operation list (slug and name only), so that it
+  /// can be shown while the server is unreachable
+  void setCachedOperations(const std::vector<dto::Operation> &operations) {
+    QVariantList cached;
+    for (const auto &op : operations) {
+      QVariantMap entry;
+      entry["slug"] = op.slug;
+      entry["name"] = op.name;
+      cached.push_back(entry);
+    }
+    settings.setValue(cachedOperationsSetting, cached);
+  }
+  std::vector<dto::Operation> getCachedOperations() {
+    std::vector<dto::Operation> rtn;
+    for (const auto &val : settings.value(cachedOperationsSetting).toList()) {
+      auto entry = val.toMap();
+      rtn.emplace_back(dto::Operation(entry["name"].toString(), entry["slug"].toString()));
+    }
+    return rtn;
+  }
+
+  void setOfflineMode(bool offline) { settings.setValue(offlineModeSetting, offline); }
+  bool offlineMode() { return settings.value(offlineModeSetting, false).toBool(); }
 };
 #endif  // APPSETTINGS_H
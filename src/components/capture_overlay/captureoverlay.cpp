@@ -0,0 +1,97 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "captureoverlay.h"
+
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+
+CaptureOverlay::CaptureOverlay(QScreen* screen)
+    : QWidget(nullptr, Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool) {
+  this->screen = screen;
+  // grabbed before the overlay is shown, so that it is not part of the image
+  screenshot = screen->grabWindow(0);
+
+  setAttribute(Qt::WA_DeleteOnClose);
+  setCursor(Qt::CrossCursor);
+  setMouseTracking(true);
+}
+
+void CaptureOverlay::start() {
+  setGeometry(screen->geometry());
+  showFullScreen();
+  raise();
+  activateWindow();
+  setFocus();
+}
+
+void CaptureOverlay::paintEvent(QPaintEvent*) {
+  QPainter painter(this);
+  painter.drawPixmap(rect(), screenshot);
+  // dim everything but the selection
+  QRegion dimmed(rect());
+  dimmed -= QRegion(selection);
+  painter.setClipRegion(dimmed);
+  painter.fillRect(rect(), QColor(0, 0, 0, 100));
+  painter.setClipping(false);
+
+  if (!selection.isEmpty()) {
+    painter.setPen(QPen(QColor(0, 120, 215), 1));
+    painter.drawRect(selection.adjusted(0, 0, -1, -1));
+  }
+}
+
+void CaptureOverlay::mousePressEvent(QMouseEvent* evt) {
+  if (evt->button() == Qt::RightButton) {
+    finish(QRect());
+    return;
+  }
+  if (evt->button() == Qt::LeftButton) {
+    dragging = true;
+    dragStart = evt->pos();
+    selection = QRect(dragStart, QSize());
+    update();
+  }
+}
+
+void CaptureOverlay::mouseMoveEvent(QMouseEvent* evt) {
+  if (dragging) {
+    selection = QRect(dragStart, evt->pos()).normalized();
+    update();
+  }
+}
+
+void CaptureOverlay::mouseReleaseEvent(QMouseEvent* evt) {
+  if (dragging && evt->button() == Qt::LeftButton) {
+    dragging = false;
+    finish(QRect(dragStart, evt->pos()).normalized());
+  }
+}
+
+void CaptureOverlay::keyPressEvent(QKeyEvent* evt) {
+  if (evt->key() == Qt::Key_Escape) {
+    finish(QRect());
+    return;
+  }
+  QWidget::keyPressEvent(evt);
+}
+
+void CaptureOverlay::finish(const QRect& area) {
+  if (finished) {
+    return;
+  }
+  finished = true;
+  close();
+
+  if (area.width() < 2 || area.height() < 2) {
+    emit selectionCancelled();
+    return;
+  }
+  // the screenshot is at device resolution, which may be larger than the widget (e.g. on HiDPI
+  // displays)
+  qreal ratio = screenshot.devicePixelRatio();
+  QRect deviceArea(qRound(area.x() * ratio), qRound(area.y() * ratio),
+                   qRound(area.width() * ratio), qRound(area.height() * ratio));
+  emit areaSelected(screenshot.copy(deviceArea).toImage());
+}
@@ -0,0 +1,61 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef CAPTUREOVERLAY_H
+#define CAPTUREOVERLAY_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QPoint>
+#include <QRect>
+#include <QScreen>
+#include <QWidget>
+
+/**
+ * @brief The CaptureOverlay class lets the user select an area of the screen to capture. It covers
+ * the given screen with a (frozen) image of its contents, taken when the overlay was created, and
+ * lets the user drag out a rectangle over it. Pressing Escape (or right clicking) cancels.
+ *
+ * The overlay deletes itself once the selection has been made or cancelled.
+ */
+class CaptureOverlay : public QWidget {
+  Q_OBJECT
+
+ public:
+  /// CaptureOverlay grabs the contents of the given screen, ready to be shown (via start)
+  explicit CaptureOverlay(QScreen* screen);
+
+  /// start shows the overlay over its screen, and waits for a selection
+  void start();
+  /// hasScreenshot returns false if the screen's contents could not be grabbed
+  bool hasScreenshot() const { return !screenshot.isNull(); }
+
+ signals:
+  /// areaSelected is emitted with the (full resolution) contents of the selected area
+  void areaSelected(QImage image);
+  /// selectionCancelled is emitted if the user backs out of the capture
+  void selectionCancelled();
+
+ protected:
+  void paintEvent(QPaintEvent* evt) override;
+  void mousePressEvent(QMouseEvent* evt) override;
+  void mouseMoveEvent(QMouseEvent* evt) override;
+  void mouseReleaseEvent(QMouseEvent* evt) override;
+  void keyPressEvent(QKeyEvent* evt) override;
+
+ private:
+  /// finish closes the overlay, emitting areaSelected for the given area (in widget coordinates),
+  /// or selectionCancelled if it is empty
+  void finish(const QRect& area);
+
+ private:
+  QScreen* screen;
+  /// screenshot holds the screen's contents, at device resolution
+  QPixmap screenshot;
+  QPoint dragStart;
+  QRect selection;
+  bool dragging = false;
+  bool finished = false;
+};
+
+#endif  // CAPTUREOVERLAY_H
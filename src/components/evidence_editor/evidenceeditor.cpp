@@ -3,6 +3,7 @@
 
 #include "evidenceeditor.h"
 
+#include <QtConcurrent>
 #include <vector>
 
 #include "components/aspectratio_pixmap_label/imageview.h"
@@ -114,34 +115,40 @@ void EvidenceEditor::wireUi() {
 
 void EvidenceEditor::loadData() {
   // get local db evidence data
-  clearEditor();
-  delete loadedPreview;
   try {
     originalEvidenceData = db->getEvidenceDetails(evidenceID);
-    descriptionTextBox->setText(originalEvidenceData.description);
-    operationSlug = originalEvidenceData.operationSlug;
-
-    if (originalEvidenceData.contentType == "image") {
-      loadedPreview = new ImageView(this);
-      loadedPreview->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    }
-    else if (originalEvidenceData.contentType == "codeblock") {
-      loadedPreview = new CodeBlockView(this);
-      loadedPreview->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    }
-    else {
-      loadedPreview =
-          new ErrorView("Unsupported evidence type: " + originalEvidenceData.contentType, this);
-    }
-    loadedPreview->loadFromFile(originalEvidenceData.path);
-    loadedPreview->setReadonly(readonly);
-
-    // get all remote tags (for op)
-    tagEditor->loadTags(operationSlug, originalEvidenceData.tags);
   }
   catch (QSqlError &e) {
+    clearEditor();
     loadedPreview = new ErrorView("Unable to load evidence: " + e.text(), this);
+    splitter->insertWidget(0, loadedPreview);
+    return;
   }
+  displayData();
+}
+
+void EvidenceEditor::displayData() {
+  clearEditor();
+  descriptionTextBox->setText(originalEvidenceData.description);
+  operationSlug = originalEvidenceData.operationSlug;
+
+  if (originalEvidenceData.contentType == "image") {
+    loadedPreview = new ImageView(this);
+    loadedPreview->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+  }
+  else if (originalEvidenceData.contentType == "codeblock") {
+    loadedPreview = new CodeBlockView(this);
+    loadedPreview->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+  }
+  else {
+    loadedPreview =
+        new ErrorView("Unsupported evidence type: " + originalEvidenceData.contentType, this);
+  }
+  loadedPreview->loadFromFile(originalEvidenceData.path);
+  loadedPreview->setReadonly(readonly);
+
+  // get all remote tags (for op)
+  tagEditor->loadTags(operationSlug, originalEvidenceData.tags);
   splitter->insertWidget(0, loadedPreview);
 }
 
@@ -155,6 +162,17 @@ void EvidenceEditor::updateEvidence(qint64 evidenceID, bool readonly) {
   }
 }
 
+void EvidenceEditor::updateEvidence(const model::Evidence &evidence, bool readonly) {
+  clearEditor();
+  setEnabled(false);
+  this->readonly = readonly;
+  this->evidenceID = evidence.id;
+  originalEvidenceData = evidence;
+  if (evidenceID > 0) {
+    displayData();
+  }
+}
+
 void EvidenceEditor::clearEditor() {
   tagEditor->clear();
   this->descriptionTextBox->setText("");
@@ -190,32 +208,39 @@ SaveEvidenceResponse EvidenceEditor::saveEvidence() {
   return resp;
 }
 
-std::vector<DeleteEvidenceResponse> EvidenceEditor::deleteEvidence(std::vector<qint64> evidenceIDs) {
+std::vector<DeleteEvidenceResponse> EvidenceEditor::deleteEvidence(
+    DatabaseConnection *db, std::vector<qint64> evidenceIDs) {
   std::vector<DeleteEvidenceResponse> responses;
 
-  for (qint64 id : evidenceIDs) {
-    model::Evidence evi = db->getEvidenceDetails(id);
-    DeleteEvidenceResponse resp(evi);
-    try {
-      db->deleteEvidence(evi.id);
-      resp.dbDeleteSuccess = true;
-    }
-    catch(QSqlError &e) {
-      resp.dbDeleteSuccess = false;
-      resp.errorText = e.text();
-    }
-    auto localFile = new QFile(evi.path);
-    if (!localFile->remove()) {
-      resp.fileDeleteSuccess = false;
-      resp.errorText += "\n" + localFile->errorString();
-    }
-    else {
-      resp.fileDeleteSuccess = true;
+  std::vector<model::Evidence> removed;
+  try {
+    removed = db->deleteEvidence(evidenceIDs);
+  }
+  catch (QSqlError &e) {
+    // nothing was deleted (the transaction was rolled back), so leave the files in place too
+    for (qint64 id : evidenceIDs) {
+      model::Evidence evi;
+      evi.id = id;
+      responses.push_back(DeleteEvidenceResponse(false, false, e.text(), evi));
     }
-    localFile->deleteLater(); // deletes the pointer, not the file
-    resp.errorText = resp.errorText.trimmed();
+    return responses;
+  }
+
+  responses.reserve(removed.size());
+  for (const auto &evi : removed) {
+    DeleteEvidenceResponse resp(evi);
+    resp.dbDeleteSuccess = true;
     responses.push_back(resp);
   }
-  
+  // unlinking is mostly waiting on the filesystem, so remove the files in parallel
+  QtConcurrent::blockingMap(responses, [](DeleteEvidenceResponse &resp) {
+    // a stack QFile, since this runs on pool threads without an event loop (so no deleteLater)
+    QFile localFile(resp.model.path);
+    resp.fileDeleteSuccess = localFile.remove();
+    if (!resp.fileDeleteSuccess) {
+      resp.errorText = localFile.errorString();
+    }
+  });
+
   return responses;
 }
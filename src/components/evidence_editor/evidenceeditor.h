@@ -31,6 +31,7 @@ class EvidenceEditor : public QWidget {
   void buildUi();
   void wireUi();
   void loadData();
+  void displayData();
   void clearEditor();
 
  public:
@@ -39,8 +40,11 @@ class EvidenceEditor : public QWidget {
   SaveEvidenceResponse saveEvidence();
 
   /// deleteEvidence is a helper method to delete both the database record and
-  /// file location of the provided evidence IDs
-  std::vector<DeleteEvidenceResponse> deleteEvidence(std::vector<qint64> evidenceIDs);
+  /// file location of the provided evidence IDs. Does not use the editor, so that it can be run
+  /// on the database worker thread (see DatabaseWorker). The records are removed in a single
+  /// transaction; files are only removed (in parallel) once that succeeds.
+  static std::vector<DeleteEvidenceResponse> deleteEvidence(DatabaseConnection *db,
+                                                            std::vector<qint64> evidenceIDs);
 
  signals:
   void onWidgetReady();
@@ -48,6 +52,11 @@ class EvidenceEditor : public QWidget {
  public slots:
   void updateEvidence(qint64 evidenceID, bool readonly);
 
+ public:
+  /// updateEvidence shows the given (already loaded, including tags) evidence, rather than reading
+  /// it from the database
+  void updateEvidence(const model::Evidence &evidence, bool readonly);
+
  private slots:
   void onTagsLoaded(bool success);
 
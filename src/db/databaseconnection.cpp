@@ -5,24 +5,31 @@
 
 #include <QDir>
 #include <QVariant>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
 #include "exceptions/databaseerr.h"
 #include "exceptions/fileerror.h"
 #include "helpers/constants.h"
+#include "helpers/perceptualhash.h"
 
 // DatabaseConnection constructs a connection to the database, unsurpringly. Note that the
 // constructor can throw a error (see below). Additionally, many methods can throw a QSqlError,
 // though are not marked as such in their comments. Other errors are listed in throw comments, or
 // are marked as noexcept if no error is possible.
 //
+// A connectionName is only needed when more than one connection is open at once (see
+// DatabaseWorker); otherwise, Qt's default connection is used.
+//
 // Throws: DBDriverUnavailable if the required database driver does not exist
-DatabaseConnection::DatabaseConnection() {
+DatabaseConnection::DatabaseConnection(const QString &connectionName, QObject *parent)
+    : QObject(parent) {
   QString dbPath = Constants::dbLocation();
   const QString DRIVER("QSQLITE");
   if (QSqlDatabase::isDriverAvailable(DRIVER)) {
-    db = QSqlDatabase::addDatabase(DRIVER);
+    db = connectionName.isEmpty() ? QSqlDatabase::addDatabase(DRIVER)
+                                  : QSqlDatabase::addDatabase(DRIVER, connectionName);
     db.setDatabaseName(dbPath);
     auto dbFileRoot = dbPath.left(dbPath.lastIndexOf("/"));
     QDir().mkpath(dbFileRoot);
@@ -32,135 +39,436 @@ DatabaseConnection::DatabaseConnection() {
   }
 }
 
-void DatabaseConnection::connect() {
+void DatabaseConnection::connect(bool migrate) {
   if (!db.open()) {
     throw db.lastError();
   }
-  migrateDB();
+  applyConnectionSettings();
+  if (migrate) {
+    migrateDB();
+  }
 }
 
-void DatabaseConnection::close() noexcept { db.close(); }
+void DatabaseConnection::close() noexcept {
+  statementCache.clear();  // prepared statements must be released before the connection closes
+  stagedSimilarTo = 0;     // temporary tables do not outlive the connection
+  db.close();
+}
+
+// applyConnectionSettings tunes the connection for this application's workload: many small writes
+// (captures, status updates) interleaved with reads of the whole evidence table. Write-ahead
+// logging lets reads proceed alongside writes, and synchronous=NORMAL only syncs at checkpoints
+// rather than on every commit (in WAL mode, this is still safe against corruption, though the
+// most recent commits may be lost on power failure). These are optimizations only, so failures
+// are logged rather than thrown.
+void DatabaseConnection::applyConnectionSettings() noexcept {
+  const std::vector<QString> pragmas = {
+      "PRAGMA journal_mode=WAL",
+      "PRAGMA synchronous=NORMAL",
+      "PRAGMA cache_size=-8192",    // in KiB (i.e. 8 MiB)
+      "PRAGMA mmap_size=67108864",  // 64 MiB
+      "PRAGMA temp_store=MEMORY",
+  };
+  for (const auto &pragma : pragmas) {
+    try {
+      executeQuery(&db, pragma);
+    }
+    catch (QSqlError &e) {
+      std::cout << "Unable to apply " << pragma.toStdString() << ": " << e.text().toStdString()
+                << std::endl;
+    }
+  }
+}
 
 qint64 DatabaseConnection::createEvidence(const QString &filepath, const QString &operationSlug,
                                           const QString &contentType) {
-  return doInsert(&db,
-                  "INSERT INTO evidence"
-                  " (path, operation_slug, content_type, recorded_date)"
-                  " VALUES"
-                  " (?, ?, ?, datetime('now'))",
-                  {filepath, operationSlug, contentType});
+  auto query = executeCached(
+      "INSERT INTO evidence"
+      " (path, operation_slug, content_type, recorded_date)"
+      " VALUES"
+      " (?, ?, ?, datetime('now'))",
+      {filepath, operationSlug, contentType});
+  qint64 evidenceID = query.lastInsertId().toLongLong();
+  emit evidenceInserted(evidenceID);
+  return evidenceID;
 }
 
-model::Evidence DatabaseConnection::getEvidenceDetails(qint64 evidenceID) {
-  model::Evidence rtn;
-  auto query = executeQuery(
-      &db,
-      "SELECT"
-      " id, path, operation_slug, content_type, description, error, recorded_date, upload_date"
-      " FROM evidence"
-      " WHERE id=? LIMIT 1",
-      {evidenceID});
-
-  if (query.first()) {
-    rtn.id = query.value("id").toLongLong();
-    rtn.path = query.value("path").toString();
-    rtn.operationSlug = query.value("operation_slug").toString();
-    rtn.contentType = query.value("content_type").toString();
-    rtn.description = query.value("description").toString();
-    rtn.errorText = query.value("error").toString();
-    rtn.recordedDate = query.value("recorded_date").toDateTime();
-    rtn.uploadDate = query.value("upload_date").toDateTime();
-
-    rtn.recordedDate.setTimeSpec(Qt::UTC);
-    rtn.uploadDate.setTimeSpec(Qt::UTC);
-
-    auto getTagQuery = executeQuery(&db,
-                                    "SELECT"
-                                    " id, tag_id, name"
-                                    " FROM tags"
-                                    " WHERE evidence_id=?",
-                                    {evidenceID});
-    while (getTagQuery.next()) {
-      rtn.tags.emplace_back(model::Tag(getTagQuery.value("id").toLongLong(),
-                                       getTagQuery.value("tag_id").toLongLong(),
-                                       getTagQuery.value("name").toString()));
+// createEvidenceSeries saves the given frames (using their path, operation slug, content type and
+// content and perceptual hashes) as a single series, in one transaction. The series is identified
+// by the ID of its first frame. Returns the new evidence IDs, in the same order as the frames.
+std::vector<qint64> DatabaseConnection::createEvidenceSeries(
+    const std::vector<model::Evidence> &frames) {
+  std::vector<qint64> evidenceIDs;
+  if (frames.empty()) {
+    return evidenceIDs;
+  }
+  inTransaction([this, &frames, &evidenceIDs]() {
+    QVariant seriesID(QVariant::LongLong);  // NULL until the first frame has been inserted
+    for (const auto &frame : frames) {
+      auto query = executeCached(
+          "INSERT INTO evidence"
+          " (path, operation_slug, content_type, content_hash, perceptual_hash, series_id,"
+          "  recorded_date)"
+          " VALUES"
+          " (?, ?, ?, ?, ?, ?, datetime('now'))",
+          {frame.path, frame.operationSlug, frame.contentType, frame.contentHash,
+           frame.perceptualHash, seriesID});
+      evidenceIDs.push_back(query.lastInsertId().toLongLong());
+      if (seriesID.isNull()) {
+        seriesID = evidenceIDs.front();
+      }
     }
+    executeCached("UPDATE evidence SET series_id=? WHERE id=?", {seriesID, evidenceIDs.front()});
+  });
+  for (qint64 evidenceID : evidenceIDs) {
+    emit evidenceInserted(evidenceID);
   }
-  else {
+  return evidenceIDs;
+}
+
+// evidenceColumns lists the evidence table columns needed to populate a model::Evidence
+// (see readEvidenceRow)
+static const QString evidenceColumns =
+    " id, path, operation_slug, content_type, description, error, recorded_date, upload_date,"
+    " queued_date, upload_attempts, next_retry_date, content_hash, series_id, perceptual_hash";
+
+// readEvidenceRow populates a model::Evidence (without tags) from the current row of the given
+// query. The query must select (at least) the evidenceColumns.
+model::Evidence DatabaseConnection::readEvidenceRow(const QSqlQuery &query) {
+  model::Evidence evi;
+  evi.id = query.value("id").toLongLong();
+  evi.path = query.value("path").toString();
+  evi.operationSlug = query.value("operation_slug").toString();
+  evi.contentType = query.value("content_type").toString();
+  evi.description = query.value("description").toString();
+  evi.errorText = query.value("error").toString();
+  evi.recordedDate = query.value("recorded_date").toDateTime();
+  evi.uploadDate = query.value("upload_date").toDateTime();
+  evi.queuedDate = query.value("queued_date").toDateTime();
+  evi.uploadAttempts = query.value("upload_attempts").toInt();
+  evi.nextRetryDate = query.value("next_retry_date").toDateTime();
+  evi.contentHash = query.value("content_hash").toString();
+  evi.seriesID = query.value("series_id").toLongLong();
+  evi.perceptualHash = query.value("perceptual_hash").toString();
+
+  evi.recordedDate.setTimeSpec(Qt::UTC);
+  evi.uploadDate.setTimeSpec(Qt::UTC);
+  evi.queuedDate.setTimeSpec(Qt::UTC);
+  evi.nextRetryDate.setTimeSpec(Qt::UTC);
+  return evi;
+}
+
+model::Evidence DatabaseConnection::getEvidenceDetails(qint64 evidenceID) {
+  auto found = getTaggedEvidence(
+      DBQuery("SELECT" + evidenceColumns + " FROM evidence WHERE id=? LIMIT 1", {evidenceID}));
+  if (found.empty()) {
     std::cout << "Could not find evidence with id: " << evidenceID << std::endl;
+    return model::Evidence();
+  }
+  return found.at(0);
+}
+
+// getEvidenceDetails retrieves the given evidence (with tags), using one query per
+// maxBindParameters ids. Evidence that does not exist is skipped. Results are ordered by id.
+std::vector<model::Evidence> DatabaseConnection::getEvidenceDetails(
+    const std::vector<qint64> &evidenceIDs) {
+  std::vector<model::Evidence> rtn;
+  for (const auto &chunk : idChunks(evidenceIDs)) {
+    auto found = getTaggedEvidence(DBQuery("SELECT" + evidenceColumns +
+                                               " FROM evidence"
+                                               " WHERE id IN (" +
+                                               placeholders(chunk.size()) + ")",
+                                           chunk),
+                                   false);
+    rtn.insert(rtn.end(), found.begin(), found.end());
+  }
+  return rtn;
+}
+
+// getTaggedEvidence runs the given evidence query (which must select the evidenceColumns), and
+// loads the tags for every resulting row in the same query, by joining against the tags table.
+// Results are sorted by the given order (which must end with e.id, so that each evidence's rows are
+// adjacent). Set cacheable to false for queries whose SQL varies from call to call (e.g. IN lists),
+// so that they do not fill up the statement cache.
+std::vector<model::Evidence> DatabaseConnection::getTaggedEvidence(const DBQuery &evidenceQuery,
+                                                                   bool cacheable,
+                                                                   const QString &order) {
+  QString stmt =
+      "SELECT e.*, t.id AS tag_row_id, t.tag_id AS tag_server_id, t.name AS tag_name"
+      " FROM (" + evidenceQuery.query() + ") AS e"
+      " LEFT JOIN tags t ON t.evidence_id = e.id"
+      " ORDER BY " + order + ", t.id";
+  auto query = cacheable ? executeCached(stmt, evidenceQuery.values())
+                         : executeQuery(&db, stmt, evidenceQuery.values());
+
+  std::vector<model::Evidence> rtn;
+  while (query.next()) {
+    // one row per (evidence, tag) pair, or a single row with NULL tag fields for untagged evidence
+    if (rtn.empty() || rtn.back().id != query.value("id").toLongLong()) {
+      rtn.push_back(readEvidenceRow(query));
+    }
+    if (!query.value("tag_row_id").isNull()) {
+      rtn.back().tags.emplace_back(model::Tag(query.value("tag_row_id").toLongLong(),
+                                              query.value("tag_server_id").toLongLong(),
+                                              query.value("tag_name").toString()));
+    }
   }
   return rtn;
 }
 
 void DatabaseConnection::updateEvidenceDescription(const QString &newDescription,
                                                    qint64 evidenceID) {
-  executeQuery(&db, "UPDATE evidence SET description=? WHERE id=?", {newDescription, evidenceID});
+  executeCached("UPDATE evidence SET description=? WHERE id=?", {newDescription, evidenceID});
+  emit evidenceUpdated({evidenceID});
 }
 
 void DatabaseConnection::deleteEvidence(qint64 evidenceID) {
-  executeQuery(&db, "DELETE FROM evidence WHERE id=?", {evidenceID});
+  deleteEvidence(std::vector<qint64>{evidenceID});
+}
+
+// deleteEvidence removes the given evidence, along with its tags, in a single transaction. Returns
+// the evidence (without tags) that was removed, so that callers can clean up the evidence files.
+// IDs that do not exist are skipped.
+std::vector<model::Evidence> DatabaseConnection::deleteEvidence(
+    const std::vector<qint64> &evidenceIDs) {
+  std::vector<model::Evidence> removed;
+  std::vector<qint64> removedIDs;
+  inTransaction([this, &evidenceIDs, &removed, &removedIDs]() {
+    for (const auto &chunk : idChunks(evidenceIDs)) {
+      QString inList = "(" + placeholders(chunk.size()) + ")";
+      auto query =
+          executeQuery(&db, "SELECT" + evidenceColumns + " FROM evidence WHERE id IN " + inList,
+                       chunk);
+      while (query.next()) {
+        removed.push_back(readEvidenceRow(query));
+        removedIDs.push_back(removed.back().id);
+      }
+      executeQuery(&db, "DELETE FROM tags WHERE evidence_id IN " + inList, chunk);
+      executeQuery(&db, "DELETE FROM evidence WHERE id IN " + inList, chunk);
+    }
+  });
+  if (!removedIDs.empty()) {
+    emit evidenceDeleted(removedIDs);
+  }
+  return removed;
 }
 
 void DatabaseConnection::updateEvidenceError(const QString &errorText, qint64 evidenceID) {
-  executeQuery(&db, "UPDATE evidence SET error=? WHERE id=?", {errorText, evidenceID});
+  executeCached("UPDATE evidence SET error=? WHERE id=?", {errorText, evidenceID});
+  emit evidenceUpdated({evidenceID});
+}
+
+void DatabaseConnection::updateEvidenceContentHash(const QString &contentHash, qint64 evidenceID) {
+  executeCached("UPDATE evidence SET content_hash=? WHERE id=?", {contentHash, evidenceID});
+  emit evidenceUpdated({evidenceID});
+}
+
+void DatabaseConnection::updateEvidencePerceptualHash(const QString &perceptualHash,
+                                                      qint64 evidenceID) {
+  executeCached("UPDATE evidence SET perceptual_hash=? WHERE id=?", {perceptualHash, evidenceID});
+  stagedSimilarTo = 0;  // the new hash may add to (or change) the staged similar set
+  emit evidenceUpdated({evidenceID});
+}
+
+// getSimilarEvidenceIDs retrieves the IDs of evidence in the same operation as the given evidence
+// that looks like it: evidence whose perceptual hash is within maxDistance bits of the given
+// evidence's (see PerceptualHash). Includes the given evidence itself, if it has been hashed.
+std::vector<qint64> DatabaseConnection::getSimilarEvidenceIDs(qint64 evidenceID, int maxDistance) {
+  std::vector<qint64> rtn;
+  auto target = executeCached(
+      "SELECT perceptual_hash, operation_slug FROM evidence WHERE id=? LIMIT 1", {evidenceID});
+  bool found = target.first();
+  QString targetHash = found ? target.value("perceptual_hash").toString() : "";
+  QString operationSlug = found ? target.value("operation_slug").toString() : "";
+  target.finish();
+
+  PerceptualHash::Bits targetBits;
+  if (!PerceptualHash::decode(targetHash, targetBits)) {
+    return rtn;  // not (yet) hashed, or could not be
+  }
+
+  // SQLite cannot count bits, so compare the hashes here
+  auto query = executeCached(
+      "SELECT id, perceptual_hash FROM evidence"
+      " WHERE operation_slug=? AND perceptual_hash IS NOT NULL",
+      {operationSlug});
+  PerceptualHash::Bits bits;
+  while (query.next()) {
+    if (PerceptualHash::decode(query.value("perceptual_hash").toString(), bits) &&
+        PerceptualHash::distance(targetBits, bits) <= maxDistance) {
+      rtn.push_back(query.value("id").toLongLong());
+    }
+  }
+  return rtn;
+}
+
+// getUnhashedImageEvidence retrieves (up to) limit image evidence (without tags) that has no
+// perceptual hash, with an id greater than afterID, in id order. Evidence that could not be hashed
+// has an empty (rather than NULL) hash, and so is not returned again.
+std::vector<model::Evidence> DatabaseConnection::getUnhashedImageEvidence(qint64 afterID,
+                                                                          int limit) {
+  auto query = executeCached("SELECT" + evidenceColumns +
+                                 " FROM evidence"
+                                 " WHERE id>? AND content_type='image' AND perceptual_hash IS NULL"
+                                 " ORDER BY id LIMIT ?",
+                             {afterID, limit});
+  std::vector<model::Evidence> rtn;
+  while (query.next()) {
+    rtn.push_back(readEvidenceRow(query));
+  }
+  return rtn;
+}
+
+// findDuplicateEvidence retrieves the oldest evidence (without tags) in the same operation with the
+// same content hash as the given evidence, preferring evidence that has already been submitted or
+// queued. Returns an Evidence with id 0 if the given evidence has no (known) duplicate.
+model::Evidence DatabaseConnection::findDuplicateEvidence(const model::Evidence &evidence) {
+  model::Evidence rtn;
+  if (evidence.contentHash.isEmpty()) {
+    return rtn;
+  }
+  auto query = executeCached("SELECT" + evidenceColumns +
+                                 " FROM evidence"
+                                 " WHERE content_hash=? AND operation_slug=? AND id<>?"
+                                 " ORDER BY (upload_date IS NULL AND queued_date IS NULL), id"
+                                 " LIMIT 1",
+                             {evidence.contentHash, evidence.operationSlug, evidence.id});
+  if (query.first()) {
+    rtn = readEvidenceRow(query);
+  }
+  query.finish();  // see executeCached
+  return rtn;
 }
 
 void DatabaseConnection::updateEvidenceSubmitted(qint64 evidenceID) {
-  executeQuery(&db, "UPDATE evidence SET upload_date=datetime('now') WHERE id=?", {evidenceID});
+  executeCached("UPDATE evidence SET upload_date=datetime('now') WHERE id=?", {evidenceID});
+  emit evidenceUpdated({evidenceID});
+}
+
+// queuedSetClause returns the SET clause used to (un)queue evidence. Queueing starts a fresh set of
+// upload attempts; un-queueing cancels any scheduled retry.
+static QString queuedSetClause(bool queued) {
+  return queued ? "queued_date=datetime('now'), upload_attempts=0, next_retry_date=NULL"
+                : "queued_date=NULL, next_retry_date=NULL";
+}
+
+void DatabaseConnection::updateEvidenceQueued(bool queued, qint64 evidenceID) {
+  executeCached("UPDATE evidence SET " + queuedSetClause(queued) + " WHERE id=?", {evidenceID});
+  emit evidenceUpdated({evidenceID});
+}
+
+void DatabaseConnection::updateEvidenceQueued(bool queued, const std::vector<qint64> &evidenceIDs) {
+  QString setClause = queuedSetClause(queued);
+  inTransaction([this, &setClause, &evidenceIDs]() {
+    for (const auto &chunk : idChunks(evidenceIDs)) {
+      executeQuery(&db,
+                   "UPDATE evidence SET " + setClause + " WHERE id IN (" +
+                       placeholders(chunk.size()) + ")",
+                   chunk);
+    }
+  });
+  emit evidenceUpdated(evidenceIDs);
+}
+
+void DatabaseConnection::updateEvidenceRetry(const QString &errorText, int uploadAttempts,
+                                             const QDateTime &nextRetryDate, qint64 evidenceID) {
+  executeCached("UPDATE evidence SET error=?, upload_attempts=?, next_retry_date=? WHERE id=?",
+                {errorText, uploadAttempts, nextRetryDate.toUTC(), evidenceID});
+  emit evidenceUpdated({evidenceID});
+}
+
+// getQueuedEvidence retrieves all evidence (without tags) that is queued for upload, but not yet
+// uploaded, oldest first.
+//
+// The partial index on queued evidence is named explicitly: otherwise SQLite prefers the
+// upload_date index (for upload_date IS NULL), and then reads and sorts every unsubmitted row.
+std::vector<model::Evidence> DatabaseConnection::getQueuedEvidence() {
+  auto query = executeCached("SELECT" + evidenceColumns +
+                             " FROM evidence INDEXED BY evidence_queued_idx"
+                             " WHERE queued_date IS NOT NULL AND upload_date IS NULL"
+                             " ORDER BY queued_date, id");
+  std::vector<model::Evidence> rtn;
+  while (query.next()) {
+    rtn.push_back(readEvidenceRow(query));
+  }
+  return rtn;
 }
 
 void DatabaseConnection::setEvidenceTags(const std::vector<model::Tag> &newTags,
                                          qint64 evidenceID) {
-  QList<QVariant> newTagIds;
-  for (const auto &tag : newTags) {
-    newTagIds.push_back(tag.serverTagId);
-  }
-  executeQuery(&db, "DELETE FROM tags WHERE tag_id NOT IN (?) AND evidence_id = ?",
-               {newTagIds, evidenceID});
-
-  auto currentTagsResult =
-      executeQuery(&db, "SELECT tag_id FROM tags WHERE evidence_id = ?", {evidenceID});
-  QList<qint64> currentTags;
-  while (currentTagsResult.next()) {
-    currentTags.push_back(currentTagsResult.value("tag_id").toLongLong());
-  }
-  struct dataset {
-    qint64 evidenceID = 0;
-    qint64 tagID = 0;
-    QString name;
-  };
-  std::vector<dataset> tagDataToInsert;
-  QString baseQuery = "INSERT INTO tags (evidence_id, tag_id, name) VALUES ";
-  for (const auto &newTag : newTags) {
-    if (currentTags.count(newTag.serverTagId) == 0) {
-      dataset item;
-      item.evidenceID = evidenceID;
-      item.tagID = newTag.serverTagId;
-      item.name = newTag.tagName;
-      tagDataToInsert.push_back(item);
+  setEvidenceTags(newTags, std::vector<qint64>{evidenceID});
+}
+
+// setEvidenceTags replaces the tags on each of the given evidence with newTags, in a single
+// transaction. Tags that are already applied are left alone; any others are removed.
+//
+// The new tags are staged in a temporary table, so that the differences can be applied with one
+// DELETE and one INSERT ... SELECT per group of evidence, regardless of how many tags there are.
+void DatabaseConnection::setEvidenceTags(const std::vector<model::Tag> &newTags,
+                                         const std::vector<qint64> &evidenceIDs) {
+  inTransaction([this, &newTags, &evidenceIDs]() {
+    executeCached(
+        "CREATE TEMP TABLE IF NOT EXISTS tag_sync"
+        " (tag_id INTEGER PRIMARY KEY, name TEXT NOT NULL)");
+    executeCached("DELETE FROM temp.tag_sync");
+
+    const size_t rowsPerInsert = maxBindParameters / 2;
+    for (size_t start = 0; start < newTags.size(); start += rowsPerInsert) {
+      size_t end = std::min(newTags.size(), start + rowsPerInsert);
+      std::vector<QVariant> args;
+      args.reserve((end - start) * 2);
+      for (size_t i = start; i < end; i++) {
+        args.emplace_back(newTags[i].serverTagId);
+        args.emplace_back(newTags[i].tagName);
+      }
+      executeQuery(&db,
+                   "INSERT OR IGNORE INTO temp.tag_sync (tag_id, name) VALUES (?,?)" +
+                       QString(", (?,?)").repeated(int(end - start - 1)),
+                   args);
     }
-  }
 
-  // one possible concern: we are going to be passing a lot of parameters
-  // sqlite indicates it's default is 100 passed parameter, but it can "handle thousands"
-  if (!tagDataToInsert.empty()) {
-    std::vector<QVariant> args;
-    baseQuery += "(?,?,?)";
-    baseQuery += QString(", (?,?,?)").repeated(int(tagDataToInsert.size() - 1));
-    for (const auto &item : tagDataToInsert) {
-      args.emplace_back(item.evidenceID);
-      args.emplace_back(item.tagID);
-      args.emplace_back(item.name);
+    for (const auto &chunk : idChunks(evidenceIDs)) {
+      QString inList = "(" + placeholders(chunk.size()) + ")";
+      executeQuery(&db,
+                   "DELETE FROM tags WHERE evidence_id IN " + inList +
+                       " AND tag_id NOT IN (SELECT tag_id FROM temp.tag_sync)",
+                   chunk);
+      executeQuery(&db,
+                   "INSERT INTO tags (evidence_id, tag_id, name)"
+                   " SELECT e.id, s.tag_id, s.name FROM evidence e CROSS JOIN temp.tag_sync s"
+                   " WHERE e.id IN " + inList +
+                       " AND NOT EXISTS (SELECT 1 FROM tags t"
+                       "  WHERE t.evidence_id = e.id AND t.tag_id = s.tag_id)",
+                   chunk);
     }
-    executeQuery(&db, baseQuery, args);
+  });
+  emit evidenceUpdated(evidenceIDs);
+}
+
+// stageSimilarEvidence stages the evidence similar to the given evidence (see
+// getSimilarEvidenceIDs) in the temp.similar_evidence table. This scans every perceptual hash in
+// the operation, so buildGetEvidenceWithFiltersQuery avoids repeating it while paging.
+void DatabaseConnection::stageSimilarEvidence(qint64 evidenceID) {
+  stagedSimilarTo = 0;  // in case staging fails part way through
+  auto similarIDs = getSimilarEvidenceIDs(evidenceID, PerceptualHash::maxSimilarDistance);
+  executeCached("CREATE TEMP TABLE IF NOT EXISTS similar_evidence (id INTEGER PRIMARY KEY)");
+  executeCached("DELETE FROM temp.similar_evidence");
+  for (const auto &chunk : idChunks(similarIDs)) {
+    executeQuery(&db,
+                 "INSERT INTO temp.similar_evidence (id) VALUES (?)" +
+                     QString(", (?)").repeated(int(chunk.size() - 1)),
+                 chunk);
   }
+  stagedSimilarTo = evidenceID;
 }
 
-DBQuery DatabaseConnection::buildGetEvidenceWithFiltersQuery(const EvidenceFilters &filters) {
-  QString query =
-      "SELECT"
-      " id, path, operation_slug, content_type, description, error, recorded_date, upload_date"
-      " FROM evidence";
+// buildGetEvidenceWithFiltersQuery builds a query selecting the evidenceColumns of all evidence
+// matching the given filters. A similarTo filter is resolved (and staged) each time, unless
+// reuseStagedSimilar is set and the same evidence's similar set is already staged on this
+// connection; paged reads set this so that the similar set is computed once per applied filter.
+DBQuery DatabaseConnection::buildGetEvidenceWithFiltersQuery(const EvidenceFilters &filters,
+                                                             bool reuseStagedSimilar) {
+  QString query = "SELECT" + evidenceColumns + " FROM evidence";
   std::vector<QVariant> values;
   std::vector<QString> parts;
 
@@ -181,6 +489,18 @@ DBQuery DatabaseConnection::buildGetEvidenceWithFiltersQuery(const EvidenceFilte
     parts.emplace_back(" content_type = ? ");
     values.emplace_back(filters.contentType);
   }
+  if (filters.seriesID > 0) {
+    parts.emplace_back(" series_id = ? ");
+    values.emplace_back(filters.seriesID);
+  }
+  if (filters.similarTo > 0) {
+    // the matches are staged in a temporary table, so that the statement stays the same (and
+    // cacheable) no matter how many there are
+    if (!reuseStagedSimilar || stagedSimilarTo != filters.similarTo) {
+      stageSimilarEvidence(filters.similarTo);
+    }
+    parts.emplace_back(" id IN (SELECT id FROM temp.similar_evidence) ");
+  }
   if (filters.startDate.isValid()) {
     parts.emplace_back(" recorded_date >= ? ");
     values.emplace_back(filters.startDate);
@@ -202,28 +522,79 @@ DBQuery DatabaseConnection::buildGetEvidenceWithFiltersQuery(const EvidenceFilte
 
 std::vector<model::Evidence> DatabaseConnection::getEvidenceWithFilters(
     const EvidenceFilters &filters) {
-  auto dbQuery = buildGetEvidenceWithFiltersQuery(filters);
-  auto resultSet = executeQuery(&db, dbQuery.query(), dbQuery.values());
-
-  std::vector<model::Evidence> allEvidence;
-  while (resultSet.next()) {
-    model::Evidence evi;
-    evi.id = resultSet.value("id").toLongLong();
-    evi.path = resultSet.value("path").toString();
-    evi.operationSlug = resultSet.value("operation_slug").toString();
-    evi.contentType = resultSet.value("content_type").toString();
-    evi.description = resultSet.value("description").toString();
-    evi.errorText = resultSet.value("error").toString();
-    evi.recordedDate = resultSet.value("recorded_date").toDateTime();
-    evi.uploadDate = resultSet.value("upload_date").toDateTime();
+  return getTaggedEvidence(buildGetEvidenceWithFiltersQuery(filters));
+}
 
-    evi.recordedDate.setTimeSpec(Qt::UTC);
-    evi.uploadDate.setTimeSpec(Qt::UTC);
+// sortExpression returns the SQL expression used to sort evidence by the given field. Missing
+// values are mapped to '' so that comparisons against them (see getEvidencePage) are never NULL.
+static QString sortExpression(EvidenceSortField field) {
+  switch (field) {
+    case SORT_OPERATION:
+      return "operation_slug";
+    case SORT_PATH:
+      return "path";
+    case SORT_CONTENT_TYPE:
+      return "content_type";
+    case SORT_DESCRIPTION:
+      return "COALESCE(description, '')";
+    case SORT_SUBMITTED:
+      return "(upload_date IS NOT NULL)";
+    case SORT_UPLOAD_DATE:
+      return "COALESCE(upload_date, '')";
+    case SORT_FAILED:
+      return "(error <> '')";
+    case SORT_ERROR:
+      return "error";
+    case SORT_RECORDED_DATE:
+    default:
+      return "recorded_date";
+  }
+}
 
-    allEvidence.push_back(evi);
+// getEvidencePage retrieves (up to) limit evidence, with tags, matching the given filters, sorted
+// by the given field (then id) in the given order. If afterID is provided, only evidence that sorts
+// after that evidence is returned (and any similarTo filter reuses the set staged for the first
+// page, so that later pages are consistent with it, and cheap). Unlike LIMIT/OFFSET, this keyset
+// approach costs the same no matter how many pages came before: SQLite can seek straight to the
+// position (when sorting by recorded_date, via the (operation_slug, recorded_date) index), rather
+// than skipping every earlier row.
+std::vector<model::Evidence> DatabaseConnection::getEvidencePage(const EvidenceFilters &filters,
+                                                                 EvidenceSortField sortField,
+                                                                 Qt::SortOrder order,
+                                                                 qint64 afterID, int limit) {
+  auto filterQuery = buildGetEvidenceWithFiltersQuery(filters, afterID > 0);
+  QString sortKey = sortExpression(sortField);
+  QString direction = (order == Qt::AscendingOrder) ? "ASC" : "DESC";
+  QString comparison = (order == Qt::AscendingOrder) ? ">" : "<";
+
+  QString stmt = "SELECT *, " + sortKey + " AS sort_key FROM (" + filterQuery.query() + ")";
+  auto values = filterQuery.values();
+  if (afterID > 0) {
+    // the position is read from the last row itself, so callers only need to track its id. It is
+    // read up front (rather than in a subquery) so that SQLite can seek to it in the index.
+    auto afterQuery =
+        executeCached("SELECT " + sortKey + " AS sort_key FROM evidence WHERE id = ?", {afterID});
+    QVariant afterKey = afterQuery.first() ? afterQuery.value("sort_key") : QVariant();
+    afterQuery.finish();
+    stmt += QString(" WHERE %1 %2 ? OR (%1 = ? AND id %2 ?)").arg(sortKey, comparison);
+    values.insert(values.end(), {afterKey, afterKey, afterID});
   }
+  stmt += QString(" ORDER BY sort_key %1, id %1 LIMIT ?").arg(direction);
+  values.emplace_back(limit);
 
-  return allEvidence;
+  return getTaggedEvidence(DBQuery(stmt, values), true,
+                           QString("e.sort_key %1, e.id %1").arg(direction));
+}
+
+std::vector<qint64> DatabaseConnection::getEvidenceIDsWithFilters(const EvidenceFilters &filters) {
+  auto filterQuery = buildGetEvidenceWithFiltersQuery(filters);
+  auto query = executeCached("SELECT id FROM (" + filterQuery.query() + ")", filterQuery.values());
+
+  std::vector<qint64> rtn;
+  while (query.next()) {
+    rtn.push_back(query.value("id").toLongLong());
+  }
+  return rtn;
 }
 
 // migrateDB checks the migration status and then performs the full migration for any
@@ -269,9 +640,10 @@ QStringList DatabaseConnection::getUnappliedMigrations() {
   QStringList appliedMigrations;
   QStringList migrationsToApply;
 
-  QSqlQuery dbMigrations("SELECT migration_name FROM migrations");
+  // this connection's db, not the default connection (which may belong to another thread)
+  QSqlQuery dbMigrations(db);
 
-  if (dbMigrations.exec()) {
+  if (dbMigrations.exec("SELECT migration_name FROM migrations")) {
     while (dbMigrations.next()) {
       appliedMigrations << dbMigrations.value("migration_name").toString();
     }
@@ -339,13 +711,76 @@ QSqlQuery DatabaseConnection::executeQuery(QSqlDatabase *db, const QString &stmt
   return query;
 }
 
-// doInsert is a version of executeQuery that returns the last inserted id, rather than the
-// underlying query/response
+// executeCached is a version of executeQuery that prepares each distinct statement only once,
+// reusing the prepared statement on later calls. Intended for statements with a fixed shape (i.e.
+// not IN lists of varying length). Note that the returned query shares its result set with the
+// cache, so its results must be read before the same statement is executed again.
+//
+// A cached SELECT that has not been read to the end keeps its read transaction open, which pins
+// this connection to a stale snapshot (and blocks WAL checkpoints). Callers that read only part of
+// the results (e.g. a single row) must call finish() on the returned query once done. As a
+// safeguard, each statement is also finished before it is executed again.
 //
 // Throws: QSqlError when a query error occurs
-qint64 DatabaseConnection::doInsert(QSqlDatabase *db, const QString &stmt,
-                                    const std::vector<QVariant> &args) {
-  auto query = executeQuery(db, stmt, args);
+QSqlQuery DatabaseConnection::executeCached(const QString &stmt,
+                                            const std::vector<QVariant> &args) {
+  auto entry = statementCache.find(stmt);
+  if (entry == statementCache.end()) {
+    QSqlQuery query(db);
+    if (!query.prepare(stmt)) {
+      throw query.lastError();
+    }
+    entry = statementCache.insert(stmt, query);
+  }
+
+  QSqlQuery &query = entry.value();
+  query.finish();
+  for (size_t i = 0; i < args.size(); i++) {
+    query.bindValue(int(i), args[i]);
+  }
+  if (!query.exec()) {
+    throw query.lastError();
+  }
+  return query;
+}
+
+// inTransaction runs the given function inside of a single database transaction. The transaction
+// is committed if the function completes, and rolled back if it throws (the error is re-thrown).
+//
+// Throws: QSqlError when the transaction cannot be started or committed
+void DatabaseConnection::inTransaction(const std::function<void()> &fn) {
+  if (!db.transaction()) {
+    throw db.lastError();
+  }
+  try {
+    fn();
+  }
+  catch (...) {
+    db.rollback();
+    throw;
+  }
+  if (!db.commit()) {
+    auto err = db.lastError();
+    db.rollback();
+    throw err;
+  }
+}
 
-  return query.lastInsertId().toLongLong();
+// idChunks splits the given ids into bind-ready groups, each small enough to stay under SQLite's
+// limit on parameters per statement. Use with placeholders to build "IN (...)" clauses.
+std::vector<std::vector<QVariant>> DatabaseConnection::idChunks(const std::vector<qint64> &ids) {
+  std::vector<std::vector<QVariant>> chunks;
+  for (size_t start = 0; start < ids.size(); start += maxBindParameters) {
+    size_t end = std::min(ids.size(), start + maxBindParameters);
+    chunks.emplace_back(ids.begin() + start, ids.begin() + end);
+  }
+  return chunks;
+}
+
+// placeholders generates a comma-separated list of count bind placeholders (e.g. "?,?,?")
+QString DatabaseConnection::placeholders(size_t count) {
+  if (count == 0) {
+    return "";
+  }
+  return "?" + QString(",?").repeated(int(count - 1));
 }
@@ -4,6 +4,8 @@
 #ifndef DATABASECONNECTION_H
 #define DATABASECONNECTION_H
 
+#include <QHash>
+#include <QObject>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QSqlError>
@@ -11,6 +13,8 @@
 #include <QStandardPaths>
 #include <QString>
 #include <QVariant>
+#include <functional>
+#include <vector>
 
 #include "forms/evidence_filter/evidencefilter.h"
 #include "models/evidence.h"
@@ -26,42 +30,115 @@ class DBQuery {
     this->_query = query;
     this->_values = values;
   }
-  inline QString query() { return _query; }
-  inline std::vector<QVariant> values() { return _values; }
+  inline QString query() const { return _query; }
+  inline std::vector<QVariant> values() const { return _values; }
 };
 
-class DatabaseConnection {
+/// EvidenceSortField lists the fields evidence can be sorted by (see getEvidencePage)
+enum EvidenceSortField {
+  SORT_RECORDED_DATE,
+  SORT_OPERATION,
+  SORT_PATH,
+  SORT_CONTENT_TYPE,
+  SORT_DESCRIPTION,
+  SORT_SUBMITTED,
+  SORT_UPLOAD_DATE,
+  SORT_FAILED,
+  SORT_ERROR,
+};
+
+/**
+ * @brief The DatabaseConnection class provides access to the local (SQLite) database. Changes to
+ * evidence made through this class are announced via the evidence* signals, so that open views can
+ * update just the affected evidence, rather than re-reading everything.
+ */
+class DatabaseConnection : public QObject {
+  Q_OBJECT
+
  public:
-  DatabaseConnection();
+  explicit DatabaseConnection(const QString &connectionName = QString(),
+                              QObject *parent = nullptr);
 
-  void connect();
+  /// connect opens the database, and (if migrate is set) applies any pending migrations. Secondary
+  /// connections (e.g. the DatabaseWorker's) should not migrate: the primary connection does so
+  /// before they are opened.
+  void connect(bool migrate = true);
   void close() noexcept;
 
-  DBQuery buildGetEvidenceWithFiltersQuery(const EvidenceFilters &filters);
+  DBQuery buildGetEvidenceWithFiltersQuery(const EvidenceFilters &filters,
+                                           bool reuseStagedSimilar = false);
 
   model::Evidence getEvidenceDetails(qint64 evidenceID);
+  std::vector<model::Evidence> getEvidenceDetails(const std::vector<qint64> &evidenceIDs);
   std::vector<model::Evidence> getEvidenceWithFilters(const EvidenceFilters &filters);
+  std::vector<model::Evidence> getEvidencePage(const EvidenceFilters &filters,
+                                               EvidenceSortField sortField, Qt::SortOrder order,
+                                               qint64 afterID, int limit);
+  std::vector<qint64> getEvidenceIDsWithFilters(const EvidenceFilters &filters);
 
   qint64 createEvidence(const QString &filepath, const QString &operationSlug,
                         const QString &contentType);
+  std::vector<qint64> createEvidenceSeries(const std::vector<model::Evidence> &frames);
 
   void updateEvidenceDescription(const QString &newDescription, qint64 evidenceID);
   void updateEvidenceError(const QString &errorText, qint64 evidenceID);
   void updateEvidenceSubmitted(qint64 evidenceID);
+  void updateEvidenceContentHash(const QString &contentHash, qint64 evidenceID);
+  model::Evidence findDuplicateEvidence(const model::Evidence &evidence);
+  void updateEvidencePerceptualHash(const QString &perceptualHash, qint64 evidenceID);
+  std::vector<qint64> getSimilarEvidenceIDs(qint64 evidenceID, int maxDistance);
+  std::vector<model::Evidence> getUnhashedImageEvidence(qint64 afterID, int limit);
+  void updateEvidenceQueued(bool queued, qint64 evidenceID);
+  void updateEvidenceQueued(bool queued, const std::vector<qint64> &evidenceIDs);
+  void updateEvidenceRetry(const QString &errorText, int uploadAttempts,
+                           const QDateTime &nextRetryDate, qint64 evidenceID);
+  std::vector<model::Evidence> getQueuedEvidence();
   void setEvidenceTags(const std::vector<model::Tag> &newTags, qint64 evidenceID);
+  void setEvidenceTags(const std::vector<model::Tag> &newTags,
+                       const std::vector<qint64> &evidenceIDs);
 
   void deleteEvidence(qint64 evidenceID);
+  std::vector<model::Evidence> deleteEvidence(const std::vector<qint64> &evidenceIDs);
+
+ signals:
+  /// evidenceInserted is emitted after new evidence has been saved
+  void evidenceInserted(qint64 evidenceID);
+  /// evidenceUpdated is emitted after the given evidence (or its tags) has been changed
+  void evidenceUpdated(std::vector<qint64> evidenceIDs);
+  /// evidenceDeleted is emitted after the given evidence has been removed
+  void evidenceDeleted(std::vector<qint64> evidenceIDs);
 
  private:
   QSqlDatabase db;
+  /// statementCache holds prepared statements, keyed by their SQL (see executeCached)
+  QHash<QString, QSqlQuery> statementCache;
+  /// stagedSimilarTo is the evidence whose similar set is staged in temp.similar_evidence, or 0 if
+  /// there is none (see stageSimilarEvidence)
+  qint64 stagedSimilarTo = 0;
+
+  /// maxBindParameters is the number of bind parameters SQLite accepts in a single statement (by
+  /// default, for versions prior to 3.32)
+  static const size_t maxBindParameters = 999;
 
   void migrateDB();
+  void applyConnectionSettings() noexcept;
+  QSqlQuery executeCached(const QString &stmt, const std::vector<QVariant> &args = {});
+  void inTransaction(const std::function<void()> &fn);
   QStringList getUnappliedMigrations();
-
+  void stageSimilarEvidence(qint64 evidenceID);
+
+  std::vector<model::Evidence> getTaggedEvidence(const DBQuery &evidenceQuery,
+                                                 bool cacheable = true,
+                                                 const QString &order = "e.id");
+  static model::Evidence readEvidenceRow(const QSqlQuery &query);
+  static std::vector<std::vector<QVariant>> idChunks(const std::vector<qint64> &ids);
+  static QString placeholders(size_t count);
   static QString extractMigrateUpContent(const QString &allContent) noexcept;
   static QSqlQuery executeQuery(QSqlDatabase *db, const QString &stmt,
                                 const std::vector<QVariant> &args = {});
-  static qint64 doInsert(QSqlDatabase *db, const QString &stmt, const std::vector<QVariant> &args);
 };
 
+// allows the change signals to be delivered across threads (see DatabaseWorker)
+Q_DECLARE_METATYPE(std::vector<qint64>)
+
 #endif  // DATABASECONNECTION_H
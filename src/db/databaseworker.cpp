@@ -0,0 +1,55 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "databaseworker.h"
+
+#include <QSqlDatabase>
+
+// workerConnectionName names the worker's connection, to keep it apart from the primary (default)
+// connection
+static const QString workerConnectionName = "ashirt-db-worker";
+
+DatabaseWorker::DatabaseWorker(DatabaseConnection* primary, QObject* parent) : QObject(parent) {
+  qRegisterMetaType<std::vector<qint64>>();
+
+  // a single thread that never expires: the connection must only be used on the thread that
+  // opened it
+  pool = new QThreadPool(this);
+  pool->setMaxThreadCount(1);
+  pool->setExpiryTimeout(-1);
+
+  QSqlError openError;
+  QtConcurrent::run(pool, [this, &openError]() {
+    auto conn = new DatabaseConnection(workerConnectionName);
+    try {
+      conn->connect(false);  // already migrated by the primary connection
+      connection = conn;
+    }
+    catch (QSqlError& e) {
+      openError = e;
+      delete conn;
+    }
+  }).waitForFinished();
+  if (connection == nullptr) {
+    throw openError;
+  }
+
+  // forwarded (queued) to the primary connection's thread
+  connect(connection, &DatabaseConnection::evidenceInserted, primary,
+          &DatabaseConnection::evidenceInserted);
+  connect(connection, &DatabaseConnection::evidenceUpdated, primary,
+          &DatabaseConnection::evidenceUpdated);
+  connect(connection, &DatabaseConnection::evidenceDeleted, primary,
+          &DatabaseConnection::evidenceDeleted);
+}
+
+DatabaseWorker::~DatabaseWorker() {
+  // waits for any queued work, then closes the connection on the thread that owns it
+  QtConcurrent::run(pool, [this]() {
+    connection->close();
+    delete connection;
+    connection = nullptr;
+    QSqlDatabase::removeDatabase(workerConnectionName);
+  }).waitForFinished();
+  pool->waitForDone();
+}
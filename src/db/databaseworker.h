@@ -0,0 +1,51 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QFuture>
+#include <QObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "db/databaseconnection.h"
+
+/**
+ * @brief The DatabaseWorker class runs database work on a dedicated background thread, so that
+ * large queries and deletes do not block the UI (or capture hotkeys). The thread owns its own
+ * connection to the database, and runs tasks one at a time, in the order they were submitted.
+ *
+ * Changes made on the worker's connection are re-announced by the primary connection's change
+ * signals (see DatabaseConnection::evidenceUpdated, etc), so views only need to watch the primary
+ * connection.
+ */
+class DatabaseWorker : public QObject {
+  Q_OBJECT
+
+ public:
+  /// DatabaseWorker starts the worker thread, and opens its connection. primary must already be
+  /// connected (and so, migrated).
+  ///
+  /// Throws: QSqlError if the worker's connection cannot be opened
+  explicit DatabaseWorker(DatabaseConnection* primary, QObject* parent = nullptr);
+  /// ~DatabaseWorker waits for any queued tasks to finish, then closes and removes the worker's
+  /// connection on the worker thread. Delete the worker while the QApplication still exists.
+  ~DatabaseWorker();
+
+  /// run queues the given task to be run on the worker thread. The task is given the worker's
+  /// connection, and must catch any QSqlError itself. The returned future holds the task's result;
+  /// use a QFutureWatcher to be notified (on the calling thread) when it is ready.
+  template <typename Task>
+  auto run(Task task) -> QFuture<decltype(task(nullptr))> {
+    return QtConcurrent::run(pool, [this, task]() { return task(connection); });
+  }
+
+ private:
+  /// pool holds the single worker thread
+  QThreadPool* pool = nullptr;
+  /// connection is the worker's database connection. Only to be used on the worker thread.
+  DatabaseConnection* connection = nullptr;
+};
+
+#endif  // DATABASEWORKER_H
@@ -9,47 +9,24 @@
 #include <QMessageBox>
 #include <QRandomGenerator>
 #include <QStandardPaths>
-#include <QTableWidgetItem>
+#include <algorithm>
 #include <iostream>
 
+#include "appconfig.h"
 #include "appsettings.h"
 #include "dtos/tag.h"
+#include "exceptions/fileerror.h"
 #include "forms/evidence_filter/evidencefilter.h"
 #include "forms/evidence_filter/evidencefilterform.h"
 #include "helpers/clipboard/clipboardhelper.h"
-#include "helpers/netman.h"
-#include "helpers/stopreply.h"
-
-enum ColumnIndexes {
-  COL_DATE_CAPTURED = 0,
-  COL_OPERATION,
-  COL_PATH,
-  COL_CONTENT_TYPE,
-  COL_DESCRIPTION,
-  COL_SUBMITTED,
-  COL_DATE_SUBMITTED,
-  COL_FAILED,
-  COL_ERROR_MSG
-};
-
-static QStringList columnNames() {
-  static QStringList names;
-  if (names.count() == 0) {
-    names.insert(COL_DATE_CAPTURED, "Date Captured");
-    names.insert(COL_OPERATION, "Operation");
-    names.insert(COL_PATH, "Path");
-    names.insert(COL_CONTENT_TYPE, "Content Type");
-    names.insert(COL_DESCRIPTION, "Description");
-    names.insert(COL_SUBMITTED, "Submitted");
-    names.insert(COL_DATE_SUBMITTED, "Date Submitted");
-    names.insert(COL_FAILED, "Failed");
-    names.insert(COL_ERROR_MSG, "Error");
-  }
-  return names;
-}
+#include "helpers/file_helpers.h"
 
-EvidenceManager::EvidenceManager(DatabaseConnection* db, QWidget* parent) : QDialog(parent) {
+EvidenceManager::EvidenceManager(DatabaseConnection* db, DatabaseWorker* dbWorker,
+                                 UploadQueue* uploadQueue, QWidget* parent)
+    : QDialog(parent) {
   this->db = db;
+  this->dbWorker = dbWorker;
+  this->uploadQueue = uploadQueue;
   buildUi();
   wireUi();
 }
@@ -58,6 +35,7 @@ EvidenceManager::~EvidenceManager() {
   delete submitEvidenceAction;
   delete deleteEvidenceAction;
   delete copyPathToClipboardAction;
+  delete showSimilarAction;
   delete deleteTableContentsAction;
   delete closeWindowAction;
   delete evidenceTableContextMenu;
@@ -68,20 +46,22 @@ EvidenceManager::~EvidenceManager() {
   delete resetFilterButton;
   delete filterTextBox;
   delete evidenceTable;
+  delete evidenceModel;
+  delete deleteWatcher;
   delete loadingAnimation;
 
   delete gridLayout;
-  stopReply(&uploadAssetReply);
 }
 
 void EvidenceManager::buildEvidenceTableUi() {
-  evidenceTable = new QTableWidget(this);
+  evidenceModel = new EvidenceTableModel(db, dbWorker, uploadQueue, this);
+  evidenceTable = new QTableView(this);
+  evidenceTable->setModel(evidenceModel);
   evidenceTable->setContextMenuPolicy(Qt::CustomContextMenu);
-  QStringList colNames = columnNames();
-  evidenceTable->setColumnCount(colNames.length());
-  evidenceTable->setHorizontalHeaderLabels(colNames);
   evidenceTable->setSelectionMode(QAbstractItemView::SingleSelection);
   evidenceTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+  evidenceTable->horizontalHeader()->setSortIndicator(EvidenceTableModel::COL_DATE_CAPTURED,
+                                                      Qt::DescendingOrder);
   evidenceTable->setSortingEnabled(true);
   evidenceTable->verticalHeader()->setVisible(false);
   evidenceTable->horizontalHeader()->setCascadingSectionResizes(false);
@@ -101,9 +81,12 @@ void EvidenceManager::buildUi() {
   evidenceTableContextMenu->addAction(deleteEvidenceAction);
   copyPathToClipboardAction = new QAction("Copy Path", evidenceTableContextMenu);
   evidenceTableContextMenu->addAction(copyPathToClipboardAction);
+  showSimilarAction = new QAction("Show Similar Captures", evidenceTableContextMenu);
+  evidenceTableContextMenu->addAction(showSimilarAction);
   evidenceTableContextMenu->addSeparator();
   deleteTableContentsAction = new QAction("Delete All from table", evidenceTableContextMenu);
   evidenceTableContextMenu->addAction(deleteTableContentsAction);
+  deleteWatcher = new QFutureWatcher<std::vector<DeleteEvidenceResponse>>(this);
 
   filterTextBox = new QLineEdit(this);
   editFiltersButton = new QPushButton("Edit Filters", this);
@@ -181,39 +164,46 @@ void EvidenceManager::wireUi() {
   connect(deleteEvidenceAction, actionTriggered, this, &EvidenceManager::deleteEvidenceTriggered);
   connect(closeWindowAction, actionTriggered, this, &EvidenceManager::close);
   connect(copyPathToClipboardAction, actionTriggered, this, &EvidenceManager::copyPathTriggered);
+  connect(showSimilarAction, actionTriggered, this, &EvidenceManager::showSimilarTriggered);
   connect(deleteTableContentsAction, actionTriggered, this, &EvidenceManager::deleteAllTriggered);
 
   connect(filterForm, &EvidenceFilterForm::evidenceSet, this, &EvidenceManager::applyFilterForm);
+  connect(deleteWatcher, &QFutureWatcher<std::vector<DeleteEvidenceResponse>>::finished, this,
+          &EvidenceManager::onDeleteComplete);
 
-  connect(this, &EvidenceManager::evidenceChanged, evidenceEditor, &EvidenceEditor::updateEvidence);
-  connect(evidenceTable, &QTableWidget::currentCellChanged, this, &EvidenceManager::onRowChanged);
-  connect(evidenceTable, &QTableWidget::customContextMenuRequested, this,
+  connect(evidenceTable->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+          &EvidenceManager::onRowChanged);
+  connect(evidenceTable, &QTableView::customContextMenuRequested, this,
           &EvidenceManager::openTableContextMenu);
+
+  connect(uploadQueue, &UploadQueue::uploadStarted, this, &EvidenceManager::onUploadStarted);
+  connect(uploadQueue, &UploadQueue::uploadProgress, this, &EvidenceManager::onUploadProgress);
+  connect(uploadQueue, &UploadQueue::uploadFinished, this, &EvidenceManager::onUploadComplete);
+  connect(uploadQueue, &UploadQueue::uploadRetryScheduled, this,
+          &EvidenceManager::onUploadRetryScheduled);
+  connect(uploadQueue, &UploadQueue::queueChanged, this, &EvidenceManager::onUploadQueueChanged);
 }
 
 void EvidenceManager::showEvent(QShowEvent* evt) {
   QDialog::showEvent(evt);
-  evidenceEditor->updateEvidence(-1, true);
   resetFilterButtonClicked();
+  // the selection may have survived the reload (see loadEvidence), so the editor is updated here
+  // rather than relying on a row change
+  auto current = evidenceTable->currentIndex();
+  showEvidence(current.isValid() ? selectedRowEvidenceID() : -1);
 }
 
 void EvidenceManager::submitEvidenceTriggered() {
-  loadingAnimation->startAnimation();
-  evidenceTable->setEnabled(false);  // prevent switching evidence while one is being submitted.
-  if (saveData()) {
-    evidenceIDForRequest = selectedRowEvidenceID();
-    try {
-      model::Evidence evi = db->getEvidenceDetails(evidenceIDForRequest);
-      uploadAssetReply = NetMan::getInstance().uploadAsset(evi);
-      connect(uploadAssetReply, &QNetworkReply::finished, this, &EvidenceManager::onUploadComplete);
-    }
-    catch (QSqlError& e) {
-      evidenceTable->setEnabled(true);
-      loadingAnimation->stopAnimation();
-      QMessageBox::warning(this, "Cannot submit evidence",
-                           "Could not retrieve data. Please try again.");
-    }
+  // saves edits for the evidence in the editor; any other selected evidence is submitted as-is
+  if (!saveData()) {
+    return;
   }
+  auto ids = selectedSubmittableEvidenceIDs();
+  uploadQueue->enqueue(ids);
+  for (qint64 id : ids) {
+    evidenceModel->setStatusText(id, "Queued");
+  }
+  submitEvidenceAction->setEnabled(false);
 }
 
 void EvidenceManager::deleteEvidenceTriggered() {
@@ -235,11 +225,19 @@ void EvidenceManager::deleteAllTriggered() {
                                      QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
 
   if (reply == QMessageBox::Yes) {
-    std::vector<qint64> ids;
-    for(int rowIndex = 0; rowIndex < evidenceTable->rowCount(); rowIndex++) {
-      ids.push_back(evidenceTable->item(rowIndex, 0)->data(Qt::UserRole).toLongLong());
-    }
-    deleteSet(ids);
+    // the table may not have loaded every matching row yet, so ask the database for them all
+    auto filters = evidenceModel->filters();
+    runDelete([filters](DatabaseConnection* workerDb) {
+      std::vector<qint64> ids;
+      try {
+        ids = workerDb->getEvidenceIDsWithFilters(filters);
+      }
+      catch (QSqlError& e) {
+        std::cout << "Could not retrieve evidence to delete. Error: " << e.text().toStdString()
+                  << std::endl;
+      }
+      return EvidenceEditor::deleteEvidence(workerDb, ids);
+    });
   }
 }
 
@@ -251,15 +249,34 @@ static QString parentDir(QString path) {
 }
 
 void EvidenceManager::deleteSet(std::vector<qint64> ids) {
-  std::vector<DeleteEvidenceResponse> responses = evidenceEditor->deleteEvidence(ids);
+  runDelete([ids](DatabaseConnection* workerDb) {
+    return EvidenceEditor::deleteEvidence(workerDb, ids);
+  });
+}
+
+void EvidenceManager::runDelete(const DeleteTask& task) {
+  // runs on the database worker, so that the UI (and capture hotkeys) stay responsive
+  deleteEvidenceAction->setEnabled(false);
+  deleteTableContentsAction->setEnabled(false);
+  deleteWatcher->setFuture(dbWorker->run(task));
+}
+
+void EvidenceManager::onDeleteComplete() {
+  deleteEvidenceAction->setEnabled(true);
+  deleteTableContentsAction->setEnabled(true);
+
+  std::vector<DeleteEvidenceResponse> responses = deleteWatcher->result();
   QStringList undeletedFiles;
   bool removedAllDbRecords = true;
   QStringList paths;
   for(auto response : responses) {
+    removedAllDbRecords = removedAllDbRecords && response.dbDeleteSuccess;
+    if (!response.dbDeleteSuccess) {
+      continue;  // files are kept when their records could not be removed
+    }
     if (!response.fileDeleteSuccess) {
       undeletedFiles << response.model.path;
     }
-    removedAllDbRecords = removedAllDbRecords && response.dbDeleteSuccess;
     auto parentPath = parentDir(response.model.path);
     if (!paths.contains(parentPath)) {
       paths << parentPath;
@@ -301,13 +318,26 @@ void EvidenceManager::deleteSet(std::vector<qint64> ids) {
     path.cdUp();
     path.rmdir(dirName);
   }
-
-  loadEvidence();
+  // deleted rows have already been removed from the table (via the database's change signals)
 }
 
 void EvidenceManager::copyPathTriggered() {
-  auto evidence = db->getEvidenceDetails(selectedRowEvidenceID());
-  ClipboardHelper::setText(evidence.path);
+  auto row = evidenceTable->currentIndex().row();
+  if (row != -1) {
+    ClipboardHelper::setText(evidenceModel->evidenceAt(row).path);
+  }
+}
+
+void EvidenceManager::showSimilarTriggered() {
+  auto row = evidenceTable->currentIndex().row();
+  if (row == -1) {
+    return;
+  }
+  // replaces the current filters: similar captures are found across the whole operation
+  EvidenceFilters filter;
+  filter.similarTo = evidenceModel->evidenceAt(row).id;
+  filterTextBox->setText(filter.toString());
+  loadEvidence();
 }
 
 void EvidenceManager::openTableContextMenu(QPoint pos) {
@@ -317,8 +347,14 @@ void EvidenceManager::openTableContextMenu(QPoint pos) {
   }
   bool singleItemSelected = selectedRowCount == 1;
   copyPathToClipboardAction->setEnabled(singleItemSelected);
-  bool wasSubmitted = !evidenceEditor->encodeEvidence().uploadDate.isNull();
-  submitEvidenceAction->setEnabled(singleItemSelected && !wasSubmitted);
+  int currentRow = evidenceTable->currentIndex().row();
+  showSimilarAction->setEnabled(singleItemSelected && currentRow != -1 &&
+                                evidenceModel->evidenceAt(currentRow).contentType == "image");
+  auto submittableCount = selectedSubmittableEvidenceIDs().size();
+  submitEvidenceAction->setText(singleItemSelected
+                                    ? "Submit Evidence"
+                                    : QString("Submit Selected (%1)").arg(submittableCount));
+  submitEvidenceAction->setEnabled(submittableCount > 0);
 
   evidenceTableContextMenu->popup(evidenceTable->viewport()->mapToGlobal(pos));
 }
@@ -337,120 +373,22 @@ void EvidenceManager::applyFilterForm(const EvidenceFilters& filter) {
 
 void EvidenceManager::loadEvidence() {
   qint64 reselectId = -1;
-  if (evidenceTable->selectedItems().size() > 0) {
+  if (evidenceTable->currentIndex().isValid()) {
     reselectId = selectedRowEvidenceID();
   }
 
-  evidenceTable->clearContents();
-
-  try {
-    auto filter = EvidenceFilters::parseFilter(filterTextBox->text());
-    std::vector<model::Evidence> operationEvidence = db->getEvidenceWithFilters(filter);
-    evidenceTable->setRowCount(operationEvidence.size());
-
-    // removing sorting temporarily to solve a bug (per qt: not a bug)
-    // Essentially, _not_ doing this breaks reloading the table. Mostly empty cells appear.
-    // from: https://stackoverflow.com/a/8904287/4262552
-    // see also: https://bugreports.qt.io/browse/QTBUG-75479
-    evidenceTable->setSortingEnabled(false);
-    for (size_t row = 0; row < operationEvidence.size(); row++) {
-      auto evi = operationEvidence.at(row);
-      auto rowData = buildBaseEvidenceRow(evi.id);
-
-      evidenceTable->setItem(row, COL_OPERATION, rowData.operation);
-      evidenceTable->setItem(row, COL_DESCRIPTION, rowData.description);
-      evidenceTable->setItem(row, COL_CONTENT_TYPE, rowData.contentType);
-      evidenceTable->setItem(row, COL_DATE_CAPTURED, rowData.dateCaptured);
-      evidenceTable->setItem(row, COL_PATH, rowData.path);
-      evidenceTable->setItem(row, COL_FAILED, rowData.failed);
-      evidenceTable->setItem(row, COL_ERROR_MSG, rowData.errorText);
-      evidenceTable->setItem(row, COL_SUBMITTED, rowData.submitted);
-      evidenceTable->setItem(row, COL_DATE_SUBMITTED, rowData.dateSubmitted);
-
-      setRowText(row, evi);
-    }
-    evidenceTable->setSortingEnabled(true);
-    if (evidenceTable->rowCount() > 0) {
-      // try to reselect the last viewed evidence, if it's still in the list
-      int selectRow = 0;
-      for (int rowIndex = 0; rowIndex < evidenceTable->rowCount(); rowIndex++) {
-        auto evidenceID = evidenceTable->item(rowIndex, 0)->data(Qt::UserRole).toLongLong();
-        if(evidenceID == reselectId) {
-          selectRow = rowIndex;
-          break;
-        }
-      }
-      evidenceTable->setCurrentCell(selectRow, 0);
-    }
-  }
-  catch (QSqlError& e) {
-    std::cout << "Could not retrieve evidence for operation. Error: " << e.text().toStdString()
-              << std::endl;
-  }
-}
-
-// buildBaseEvidenceRow constructs a container for a row of data.
-// Note: the row (container) is on the stack, but items in the container
-// are on the heap, and must be deleted.
-EvidenceRow EvidenceManager::buildBaseEvidenceRow(qint64 evidenceID) {
-  EvidenceRow row{};
-  auto basicItem = [evidenceID]() -> QTableWidgetItem* {
-    auto item = new QTableWidgetItem();
-    item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-    item->setData(Qt::UserRole, evidenceID);
-    return item;
-  };
-
-  row.dateCaptured = basicItem();
-  row.description = basicItem();
-  row.operation = basicItem();
-  row.contentType = basicItem();
-  row.path = basicItem();
-  row.errorText = basicItem();
-  row.dateSubmitted = basicItem();
-
-  row.submitted = basicItem();
-  row.submitted->setTextAlignment(Qt::AlignCenter);
-  row.failed = basicItem();
-  row.failed->setTextAlignment(Qt::AlignCenter);
-
-  return row;
-}
-
-void EvidenceManager::setRowText(int row, const model::Evidence& model) {
-  static QString dateFormat = QLocale().dateTimeFormat(QLocale::ShortFormat);
-
-  auto setColText = [this, row](int col, QString text) {
-    evidenceTable->item(row, col)->setText(text);
-  };
-  setColText(COL_DATE_CAPTURED, model.recordedDate.toLocalTime().toString(dateFormat));
-  setColText(COL_DESCRIPTION, model.description);
-  setColText(COL_OPERATION, model.operationSlug);
-  setColText(COL_CONTENT_TYPE, model.contentType);
-  setColText(COL_SUBMITTED, model.uploadDate.isNull() ? "No" : "Yes");
-  setColText(COL_FAILED, model.errorText == "" ? "" : "Yes");
-  setColText(COL_PATH, QDir::toNativeSeparators(model.path));
-  setColText(COL_ERROR_MSG, model.errorText);
-
-  auto uploadDateText = model.uploadDate.isNull() ? "Never" : model.uploadDate.toLocalTime().toString(dateFormat);
-  setColText(COL_DATE_SUBMITTED, uploadDateText);
-}
-
-void EvidenceManager::refreshRow(int row) {
-  auto evidenceID = selectedRowEvidenceID();
-  try {
-    auto updatedData = db->getEvidenceDetails(evidenceID);
-    setRowText(row, updatedData);
-  }
-  catch (QSqlError& e) {
-    std::cout << "Could not refresh table row: " << e.text().toStdString() << std::endl;
+  // with unchanged filters, the model is refreshed in place, keeping the selection and scroll
+  // position; otherwise it is reset, and the last viewed evidence is reselected if still listed
+  evidenceModel->setFilters(EvidenceFilters::parseFilter(filterTextBox->text()));
+  if (!evidenceTable->currentIndex().isValid() && evidenceModel->rowCount() > 0) {
+    int selectRow = std::max(0, evidenceModel->rowForEvidenceID(reselectId));
+    evidenceTable->setCurrentIndex(evidenceModel->index(selectRow, 0));
   }
 }
 
 bool EvidenceManager::saveData() {
   auto saveResponse = evidenceEditor->saveEvidence();
   if (saveResponse.actionSucceeded) {
-    refreshRow(evidenceTable->currentRow());
     return true;
   }
 
@@ -466,65 +404,70 @@ void EvidenceManager::openFiltersMenu() {
   filterForm->open();
 }
 
-void EvidenceManager::onRowChanged(int currentRow, int _currentColumn, int _previousRow,
-                                   int _previousColumn) {
-  Q_UNUSED(_currentColumn);
-  Q_UNUSED(_previousRow);
-  Q_UNUSED(_previousColumn);
+void EvidenceManager::onRowChanged(const QModelIndex& current, const QModelIndex& _previous) {
+  Q_UNUSED(_previous);
 
-  if (currentRow == -1) {
-    emit evidenceChanged(-1, true);
+  if (!current.isValid()) {
+    showEvidence(-1);
     return;
   }
 
-  auto evidence = db->getEvidenceDetails(selectedRowEvidenceID());
-
+  const auto& evidence = evidenceModel->evidenceAt(current.row());
   auto readonly = evidence.uploadDate.isValid();
-  submitEvidenceAction->setEnabled(!readonly);
-  emit evidenceChanged(evidence.id, true);
+  submitEvidenceAction->setEnabled(!readonly && !uploadQueue->isQueued(evidence.id));
+  showEvidence(evidence.id);
+}
+
+void EvidenceManager::showEvidence(qint64 evidenceID) {
+  int row = evidenceModel->rowForEvidenceID(evidenceID);
+  if (row != -1) {
+    evidenceEditor->updateEvidence(evidenceModel->evidenceAt(row), true);
+  }
+  else {
+    evidenceEditor->updateEvidence(evidenceID, true);
+  }
+  emit evidenceChanged(evidenceID, true);
 }
 
-void EvidenceManager::onUploadComplete() {
-  bool isValid;
-  NetMan::extractResponse(uploadAssetReply, isValid);
+void EvidenceManager::onUploadComplete(qint64 evidenceID, bool success, QString errorText) {
+  Q_UNUSED(success);
+  Q_UNUSED(errorText);  // the result is recorded in the database, and shown in the table
 
-  if (!isValid) {
-    auto errMessage =
-        "Unable to upload evidence: Network error (" + uploadAssetReply->errorString() + ")";
-    try {
-      db->updateEvidenceError(errMessage, evidenceIDForRequest);
-    }
-    catch (QSqlError& e) {
-      std::cout << "Upload failed. Could not update internal database. Error: "
-                << e.text().toStdString() << std::endl;
-    }
-    QMessageBox::warning(this, "Cannot Submit Evidence",
-                         "Upload failed: Network error. Check your connection and try again.\n"
-                         "(Error: " +
-                             uploadAssetReply->errorString() + ")");
+  // the table has already been updated (via the database's change signals)
+  if (evidenceTable->currentIndex().isValid() && selectedRowEvidenceID() == evidenceID) {
+    showEvidence(evidenceID);
+  }
+}
+
+void EvidenceManager::onUploadRetryScheduled(qint64 evidenceID, int attempt, QDateTime nextAttempt,
+                                             QString errorText) {
+  Q_UNUSED(attempt);
+  Q_UNUSED(nextAttempt);
+  onUploadComplete(evidenceID, false, errorText);
+}
+
+void EvidenceManager::onUploadQueueChanged(int pending, int active) {
+  if (pending + active > 0) {
+    loadingAnimation->startAnimation();
   }
   else {
-    try {
-      db->updateEvidenceSubmitted(evidenceIDForRequest);
-    }
-    catch (QSqlError& e) {
-      std::cout << "Upload successful. Could not update internal database. Error: "
-                << e.text().toStdString() << std::endl;
-    }
-    emit evidenceChanged(evidenceIDForRequest, true);  // lock the editing form
+    loadingAnimation->stopAnimation();
   }
-  refreshRow(evidenceTable->currentRow());
+}
 
-  // we don't actually need anything from the uploadAssets reply, so just clean it up.
-  // one thing we might want to record: evidence uuid... not sure why we'd need it though.
-  loadingAnimation->stopAnimation();
-  evidenceTable->setEnabled(true);
+void EvidenceManager::onUploadStarted(qint64 evidenceID) {
+  evidenceModel->setStatusText(evidenceID, "Uploading");
+}
 
-  tidyReply(&uploadAssetReply);
+void EvidenceManager::onUploadProgress(qint64 evidenceID, qint64 bytesSent, qint64 bytesTotal) {
+  if (bytesTotal > 0) {
+    evidenceModel->setStatusText(evidenceID,
+                                 QString("Uploading (%1%)").arg(bytesSent * 100 / bytesTotal));
+  }
 }
 
 qint64 EvidenceManager::selectedRowEvidenceID() {
-  return evidenceTable->currentItem()->data(Qt::UserRole).toLongLong();
+  return evidenceTable->currentIndex().data(EvidenceTableModel::ROLE_EVIDENCE_ID).toLongLong();
 }
 
 std::vector<qint64> EvidenceManager::selectedRowEvidenceIDs() {
@@ -533,7 +476,21 @@ std::vector<qint64> EvidenceManager::selectedRowEvidenceIDs() {
   // relies on the fact that entire rows are selected
   auto itemList = evidenceTable->selectionModel()->selectedRows();
   for (auto item : itemList) {
-    rtn.push_back(item.data(Qt::UserRole).toLongLong());
+    rtn.push_back(item.data(EvidenceTableModel::ROLE_EVIDENCE_ID).toLongLong());
   }
   return  rtn;
 }
+
+std::vector<qint64> EvidenceManager::selectedSubmittableEvidenceIDs() {
+  std::vector<qint64> rtn;
+
+  auto itemList = evidenceTable->selectionModel()->selectedRows();
+  for (auto item : itemList) {
+    qint64 evidenceID = item.data(EvidenceTableModel::ROLE_EVIDENCE_ID).toLongLong();
+    bool wasSubmitted = item.data(EvidenceTableModel::ROLE_SUBMITTED).toBool();
+    if (!wasSubmitted && !uploadQueue->isQueued(evidenceID)) {
+      rtn.push_back(evidenceID);
+    }
+  }
+  return rtn;
+}
@@ -6,30 +6,21 @@
 
 #include <QAction>
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QLineEdit>
 #include <QMenu>
-#include <QNetworkReply>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QPushButton>
+#include <QTableView>
+#include <functional>
+#include <vector>
 
 #include "components/evidence_editor/evidenceeditor.h"
 #include "components/loading/qprogressindicator.h"
 #include "db/databaseconnection.h"
+#include "db/databaseworker.h"
+#include "forms/evidence/evidencetablemodel.h"
 #include "forms/evidence_filter/evidencefilterform.h"
-
-/// EvidenceRow contains the necessary data for a full row in the evidence table.
-/// QTableWidget should memory-manage this data.
-struct EvidenceRow {
-  QTableWidgetItem* dateCaptured;
-  QTableWidgetItem* description;
-  QTableWidgetItem* contentType;
-  QTableWidgetItem* operation;
-  QTableWidgetItem* submitted;
-  QTableWidgetItem* failed;
-  QTableWidgetItem* path;
-  QTableWidgetItem* errorText;
-  QTableWidgetItem* dateSubmitted;
-};
+#include "helpers/uploadqueue.h"
 
 /**
  * @brief The EvidenceManager class represents the Evidence Manager window that is shown
@@ -39,7 +30,8 @@ class EvidenceManager : public QDialog {
   Q_OBJECT
 
  public:
-  explicit EvidenceManager(DatabaseConnection* db, QWidget* parent = nullptr);
+  explicit EvidenceManager(DatabaseConnection* db, DatabaseWorker* dbWorker,
+                           UploadQueue* uploadQueue, QWidget* parent = nullptr);
   ~EvidenceManager();
 
  private:
@@ -55,14 +47,11 @@ class EvidenceManager : public QDialog {
 
   /// saveData stores any edits in evidence view. Deprecated (edits no longer available)
   bool saveData();
-  /// loadEvidence retrieves data from the database and renders the evidence table
+  /// loadEvidence reloads the evidence table using the current filters
   void loadEvidence();
-  /// buildBaseEvidenceRow constructs a basic evidence row (fields and formatting, no data applied)
-  EvidenceRow buildBaseEvidenceRow(qint64 evidenceID);
-  /// refreshRow updates the indicated row (0-based) with updated (database) data.
-  void refreshRow(int row);
-  /// setRowText writes data the indicated row (0-based) based on the given model
-  void setRowText(int row, const model::Evidence& model);
+  /// showEvidence displays the given evidence in the editor, using the data already loaded for the
+  /// table where possible
+  void showEvidence(qint64 evidenceID);
 
   /// showEvent extends QDialog's showEvent. Resets the applied filters.
   void showEvent(QShowEvent* evt) override;
@@ -70,6 +59,9 @@ class EvidenceManager : public QDialog {
   qint64 selectedRowEvidenceID();
   /// selectedRowEvidenceIDs is a small helper to retrieve the id for all the selected rows
   std::vector<qint64> selectedRowEvidenceIDs();
+  /// selectedSubmittableEvidenceIDs retrieves the ids for the selected rows that have been neither
+  /// submitted nor queued for submission
+  std::vector<qint64> selectedSubmittableEvidenceIDs();
 
  signals:
   /**
@@ -92,6 +84,8 @@ class EvidenceManager : public QDialog {
   /// deleteSet is a small helper to iterate through the provided list, delete the ids, and process
   /// the result
   void deleteSet(std::vector<qint64> ids);
+  /// onDeleteComplete processes the result of a delete started by runDelete
+  void onDeleteComplete();
 
   /// applyFilterForm updates the filter textbox to reflect the filter options chosen in the filter
   /// menu
@@ -99,20 +93,42 @@ class EvidenceManager : public QDialog {
   /// openFiltersMenu opens the filter menu with the current filters applied
   void openFiltersMenu();
 
-  /// onRowChanged recieves the event from the evidence table rowChange signal
-  void onRowChanged(int currentRow, int currentColumn, int previousRow, int previousColumn);
-  /// onUploadComplete is triggered when the upload response has been received.
-  void onUploadComplete();
+  /// onRowChanged recieves the event from the evidence table's currentRowChanged signal
+  void onRowChanged(const QModelIndex& current, const QModelIndex& previous);
+  /// onUploadStarted is triggered when the upload queue starts uploading some evidence.
+  void onUploadStarted(qint64 evidenceID);
+  /// onUploadProgress is triggered as the upload queue sends some evidence.
+  void onUploadProgress(qint64 evidenceID, qint64 bytesSent, qint64 bytesTotal);
+  /// onUploadComplete is triggered when the upload queue has finished uploading some evidence.
+  void onUploadComplete(qint64 evidenceID, bool success, QString errorText);
+  /// onUploadRetryScheduled is triggered when an upload attempt failed, but will be retried later.
+  void onUploadRetryScheduled(qint64 evidenceID, int attempt, QDateTime nextAttempt,
+                              QString errorText);
+  /// onUploadQueueChanged is triggered when uploads are added to, or removed from, the upload queue
+  void onUploadQueueChanged(int pending, int active);
 
   /// copyPathTriggered recives the triggered event from the copyPathToClipboardAction
   void copyPathTriggered();
+  /// showSimilarTriggered filters the table down to evidence that looks like the selected image
+  /// (see EvidenceFilters::similarTo)
+  void showSimilarTriggered();
 
  private:
+  /// DeleteTask deletes evidence using the given (worker) connection. See runDelete.
+  typedef std::function<std::vector<DeleteEvidenceResponse>(DatabaseConnection*)> DeleteTask;
+  /// runDelete runs the given delete on the database worker, then calls onDeleteComplete
+  void runDelete(const DeleteTask& task);
+
   /// db is a (shared) reference to the local database instance. Not to be deleted.
   DatabaseConnection* db;
-
-  QNetworkReply* uploadAssetReply = nullptr;
-  qint64 evidenceIDForRequest = 0;
+  /// dbWorker is a (shared) reference to the database worker. Not to be deleted.
+  DatabaseWorker* dbWorker;
+  /// deleteWatcher reports when a delete (see runDelete) has finished
+  QFutureWatcher<std::vector<DeleteEvidenceResponse>>* deleteWatcher = nullptr;
+  /// uploadQueue is a (shared) reference to the background upload queue. Not to be deleted.
+  UploadQueue* uploadQueue;
+  /// evidenceModel provides (and holds) the evidence listed in the evidence table
+  EvidenceTableModel* evidenceModel = nullptr;
 
   // Subwindows
   EvidenceFilterForm* filterForm = nullptr;
@@ -122,6 +138,7 @@ class EvidenceManager : public QDialog {
   QAction* deleteEvidenceAction = nullptr;
   QAction* closeWindowAction = nullptr;
   QAction* copyPathToClipboardAction = nullptr;
+  QAction* showSimilarAction = nullptr;
   QAction* deleteTableContentsAction = nullptr;
 
   // UI Elements
@@ -130,7 +147,7 @@ class EvidenceManager : public QDialog {
   QPushButton* applyFilterButton = nullptr;
   QPushButton* resetFilterButton = nullptr;
   QLineEdit* filterTextBox = nullptr;
-  QTableWidget* evidenceTable = nullptr;
+  QTableView* evidenceTable = nullptr;
   EvidenceEditor* evidenceEditor = nullptr;
   QProgressIndicator* loadingAnimation = nullptr;
   QSpacerItem* spacer = nullptr;
@@ -0,0 +1,603 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "evidencetablemodel.h"
+
+#include <QDir>
+#include <QLocale>
+#include <QTimer>
+#include <algorithm>
+#include <iostream>
+
+// pageSize is the number of evidence read from the database at a time
+static const int pageSize = 200;
+
+// insertRefreshDelay is how long (in milliseconds) to wait after new evidence is saved before
+// refreshing, so that a burst of captures results in a single refresh
+static const int insertRefreshDelay = 250;
+
+static QStringList columnNames() {
+  static QStringList names;
+  if (names.count() == 0) {
+    names.insert(EvidenceTableModel::COL_DATE_CAPTURED, "Date Captured");
+    names.insert(EvidenceTableModel::COL_OPERATION, "Operation");
+    names.insert(EvidenceTableModel::COL_PATH, "Path");
+    names.insert(EvidenceTableModel::COL_CONTENT_TYPE, "Content Type");
+    names.insert(EvidenceTableModel::COL_DESCRIPTION, "Description");
+    names.insert(EvidenceTableModel::COL_SUBMITTED, "Submitted");
+    names.insert(EvidenceTableModel::COL_DATE_SUBMITTED, "Date Submitted");
+    names.insert(EvidenceTableModel::COL_FAILED, "Failed");
+    names.insert(EvidenceTableModel::COL_ERROR_MSG, "Error");
+  }
+  return names;
+}
+
+// sortField maps each column to the database field it is sorted by
+static EvidenceSortField sortField(int column) {
+  switch (column) {
+    case EvidenceTableModel::COL_OPERATION:
+      return SORT_OPERATION;
+    case EvidenceTableModel::COL_PATH:
+      return SORT_PATH;
+    case EvidenceTableModel::COL_CONTENT_TYPE:
+      return SORT_CONTENT_TYPE;
+    case EvidenceTableModel::COL_DESCRIPTION:
+      return SORT_DESCRIPTION;
+    case EvidenceTableModel::COL_SUBMITTED:
+      return SORT_SUBMITTED;
+    case EvidenceTableModel::COL_DATE_SUBMITTED:
+      return SORT_UPLOAD_DATE;
+    case EvidenceTableModel::COL_FAILED:
+      return SORT_FAILED;
+    case EvidenceTableModel::COL_ERROR_MSG:
+      return SORT_ERROR;
+    case EvidenceTableModel::COL_DATE_CAPTURED:
+    default:
+      return SORT_RECORDED_DATE;
+  }
+}
+
+void EvidenceTableModel::RowCache::clear() {
+  ids.clear();
+  recordedDates.clear();
+  operationSlugs.clear();
+  paths.clear();
+  contentTypes.clear();
+  descriptions.clear();
+  errors.clear();
+  uploadDates.clear();
+  nextRetryDates.clear();
+  queued.clear();
+  tags.clear();
+}
+
+void EvidenceTableModel::RowCache::append(const model::Evidence& evi) {
+  ids.push_back(evi.id);
+  recordedDates.push_back(evi.recordedDate);
+  operationSlugs.push_back(evi.operationSlug);
+  paths.push_back(evi.path);
+  contentTypes.push_back(evi.contentType);
+  descriptions.push_back(evi.description);
+  errors.push_back(evi.errorText);
+  uploadDates.push_back(evi.uploadDate);
+  nextRetryDates.push_back(evi.nextRetryDate);
+  queued.push_back(!evi.queuedDate.isNull());
+  tags.push_back(evi.tags);
+}
+
+void EvidenceTableModel::RowCache::set(size_t row, const model::Evidence& evi) {
+  ids.at(row) = evi.id;
+  recordedDates.at(row) = evi.recordedDate;
+  operationSlugs.at(row) = evi.operationSlug;
+  paths.at(row) = evi.path;
+  contentTypes.at(row) = evi.contentType;
+  descriptions.at(row) = evi.description;
+  errors.at(row) = evi.errorText;
+  uploadDates.at(row) = evi.uploadDate;
+  nextRetryDates.at(row) = evi.nextRetryDate;
+  queued.at(row) = !evi.queuedDate.isNull();
+  tags.at(row) = evi.tags;
+}
+
+void EvidenceTableModel::RowCache::insert(size_t row, const model::Evidence& evi) {
+  ids.insert(ids.begin() + row, evi.id);
+  recordedDates.insert(recordedDates.begin() + row, evi.recordedDate);
+  operationSlugs.insert(operationSlugs.begin() + row, evi.operationSlug);
+  paths.insert(paths.begin() + row, evi.path);
+  contentTypes.insert(contentTypes.begin() + row, evi.contentType);
+  descriptions.insert(descriptions.begin() + row, evi.description);
+  errors.insert(errors.begin() + row, evi.errorText);
+  uploadDates.insert(uploadDates.begin() + row, evi.uploadDate);
+  nextRetryDates.insert(nextRetryDates.begin() + row, evi.nextRetryDate);
+  queued.insert(queued.begin() + row, !evi.queuedDate.isNull());
+  tags.insert(tags.begin() + row, evi.tags);
+}
+
+// eraseRange removes the (inclusive) range of elements from the given column
+template <typename T>
+static void eraseRange(std::vector<T>& column, size_t first, size_t last) {
+  column.erase(column.begin() + first, column.begin() + last + 1);
+}
+
+void EvidenceTableModel::RowCache::erase(size_t first, size_t last) {
+  eraseRange(ids, first, last);
+  eraseRange(recordedDates, first, last);
+  eraseRange(operationSlugs, first, last);
+  eraseRange(paths, first, last);
+  eraseRange(contentTypes, first, last);
+  eraseRange(descriptions, first, last);
+  eraseRange(errors, first, last);
+  eraseRange(uploadDates, first, last);
+  eraseRange(nextRetryDates, first, last);
+  eraseRange(queued, first, last);
+  eraseRange(tags, first, last);
+}
+
+// moveElement moves a single element within the given column, shifting those in between
+template <typename T>
+static void moveElement(std::vector<T>& column, size_t from, size_t to) {
+  T value = std::move(column[from]);
+  column.erase(column.begin() + from);
+  column.insert(column.begin() + to, std::move(value));
+}
+
+void EvidenceTableModel::RowCache::move(size_t from, size_t to) {
+  moveElement(ids, from, to);
+  moveElement(recordedDates, from, to);
+  moveElement(operationSlugs, from, to);
+  moveElement(paths, from, to);
+  moveElement(contentTypes, from, to);
+  moveElement(descriptions, from, to);
+  moveElement(errors, from, to);
+  moveElement(uploadDates, from, to);
+  moveElement(nextRetryDates, from, to);
+  moveElement(queued, from, to);
+  moveElement(tags, from, to);
+}
+
+bool EvidenceTableModel::RowCache::matches(size_t row, const model::Evidence& evi) const {
+  if (tags.at(row).size() != evi.tags.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < evi.tags.size(); i++) {
+    if (tags[row][i].serverTagId != evi.tags[i].serverTagId) {
+      return false;
+    }
+  }
+  return ids[row] == evi.id && recordedDates[row] == evi.recordedDate &&
+         operationSlugs[row] == evi.operationSlug && paths[row] == evi.path &&
+         contentTypes[row] == evi.contentType && descriptions[row] == evi.description &&
+         errors[row] == evi.errorText && uploadDates[row] == evi.uploadDate &&
+         nextRetryDates[row] == evi.nextRetryDate && queued[row] == !evi.queuedDate.isNull();
+}
+
+model::Evidence EvidenceTableModel::RowCache::at(size_t row) const {
+  model::Evidence evi;
+  evi.id = ids.at(row);
+  evi.recordedDate = recordedDates.at(row);
+  evi.operationSlug = operationSlugs.at(row);
+  evi.path = paths.at(row);
+  evi.contentType = contentTypes.at(row);
+  evi.description = descriptions.at(row);
+  evi.errorText = errors.at(row);
+  evi.uploadDate = uploadDates.at(row);
+  evi.nextRetryDate = nextRetryDates.at(row);
+  evi.tags = tags.at(row);
+  return evi;
+}
+
+EvidenceTableModel::EvidenceTableModel(DatabaseConnection* db, DatabaseWorker* dbWorker,
+                                       UploadQueue* uploadQueue, QObject* parent)
+    : QAbstractTableModel(parent) {
+  this->db = db;
+  this->dbWorker = dbWorker;
+  this->uploadQueue = uploadQueue;
+
+  refreshWatcher = new QFutureWatcher<RefreshResult>(this);
+  connect(refreshWatcher, &QFutureWatcher<RefreshResult>::finished, this,
+          &EvidenceTableModel::onRefreshComplete);
+  updateWatcher = new QFutureWatcher<UpdatedRows>(this);
+  connect(updateWatcher, &QFutureWatcher<UpdatedRows>::finished, this,
+          &EvidenceTableModel::onUpdatedRowsRead);
+
+  refreshTimer = new QTimer(this);
+  refreshTimer->setSingleShot(true);
+  refreshTimer->setInterval(insertRefreshDelay);
+  connect(refreshTimer, &QTimer::timeout, this, [this]() {
+    if (loaded) {
+      refresh();
+    }
+  });
+
+  connect(db, &DatabaseConnection::evidenceInserted, this, &EvidenceTableModel::onEvidenceInserted);
+  connect(db, &DatabaseConnection::evidenceUpdated, this, &EvidenceTableModel::onEvidenceUpdated);
+  connect(db, &DatabaseConnection::evidenceDeleted, this, &EvidenceTableModel::onEvidenceDeleted);
+}
+
+void EvidenceTableModel::setFilters(const EvidenceFilters& filters) {
+  if (loaded && filters.toString() == currentFilters.toString()) {
+    if (stale) {
+      refresh();
+    }
+    return;
+  }
+  currentFilters = filters;
+  reload();
+}
+
+void EvidenceTableModel::reload() {
+  beginResetModel();
+  generation++;
+  rows.clear();
+  rowIndex.clear();
+  statusText.clear();
+  pendingUpdates.clear();
+  allRowsLoaded = false;
+  fetchDeferred = false;
+  stale = false;
+  appendRows(readNextPage());
+  loaded = true;
+  endResetModel();
+}
+
+void EvidenceTableModel::refresh() {
+  if (refreshWatcher->isRunning()) {
+    refreshQueued = true;  // started again once the current refresh completes
+    return;
+  }
+  stale = false;
+  refreshTimer->stop();
+
+  // re-read (at least) as many rows as are loaded, so that the view does not shrink
+  int limit = std::max(pageSize, int(rows.size()));
+  auto filters = currentFilters;
+  auto field = sortField(sortColumn);
+  auto order = sortOrder;
+  refreshGeneration = generation;
+  refreshWatcher->setFuture(
+      dbWorker->run([filters, field, order, limit](DatabaseConnection* workerDb) {
+        RefreshResult result;
+        result.limit = limit;
+        try {
+          result.evidence = workerDb->getEvidencePage(filters, field, order, 0, limit);
+          result.success = true;
+        }
+        catch (QSqlError& e) {
+          std::cout << "Could not refresh evidence. Error: " << e.text().toStdString()
+                    << std::endl;
+        }
+        return result;
+      }));
+}
+
+void EvidenceTableModel::onRefreshComplete() {
+  auto result = refreshWatcher->result();
+  if (!result.success) {
+    stale = true;
+  }
+  else if (refreshGeneration == generation) {  // otherwise, the model was reset in the meantime
+    applyRefresh(result.evidence, result.limit);
+  }
+  if (refreshQueued) {
+    refreshQueued = false;
+    refresh();
+  }
+  else if (fetchDeferred) {
+    fetchDeferred = false;
+    fetchMore(QModelIndex());
+  }
+}
+
+void EvidenceTableModel::applyRefresh(const std::vector<model::Evidence>& latest, int limit) {
+  allRowsLoaded = latest.size() < size_t(limit);
+
+  std::unordered_set<qint64> latestIDs;
+  for (const auto& evi : latest) {
+    latestIDs.insert(evi.id);
+  }
+  removeRowsWhere([&latestIDs](qint64 evidenceID) { return latestIDs.count(evidenceID) == 0; });
+
+  std::unordered_set<qint64> remaining(rows.ids.begin(), rows.ids.end());
+
+  // every remaining row is in latest, so walk latest and bring each row into place
+  for (size_t row = 0; row < latest.size(); row++) {
+    const auto& evi = latest[row];
+    if (remaining.count(evi.id) == 0) {
+      // insert this, and any directly following, new evidence in one go
+      size_t end = row + 1;
+      while (end < latest.size() && remaining.count(latest[end].id) == 0) {
+        end++;
+      }
+      beginInsertRows(QModelIndex(), int(row), int(end - 1));
+      for (size_t i = row; i < end; i++) {
+        rows.insert(i, latest[i]);
+      }
+      rebuildRowIndex();
+      endInsertRows();
+      row = end - 1;
+      continue;
+    }
+    if (rows.ids[row] != evi.id) {
+      // its sort value changed; move it up from further down
+      auto from = size_t(std::find(rows.ids.begin() + long(row), rows.ids.end(), evi.id) -
+                         rows.ids.begin());
+      beginMoveRows(QModelIndex(), int(from), int(from), QModelIndex(), int(row));
+      rows.move(from, row);
+      rebuildRowIndex();
+      endMoveRows();
+    }
+    if (!rows.matches(row, evi)) {
+      rows.set(row, evi);
+      statusText.erase(evi.id);
+      emit dataChanged(index(int(row), 0), index(int(row), COLUMN_COUNT - 1));
+    }
+  }
+}
+
+void EvidenceTableModel::removeRowsWhere(const std::function<bool(qint64)>& shouldRemove) {
+  // one contiguous run at a time, from the bottom, so that row numbers above are unaffected
+  for (int last = int(rows.size()) - 1; last >= 0; last--) {
+    if (!shouldRemove(rows.ids[size_t(last)])) {
+      continue;
+    }
+    int first = last;
+    while (first > 0 && shouldRemove(rows.ids[size_t(first - 1)])) {
+      first--;
+    }
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int row = first; row <= last; row++) {
+      statusText.erase(rows.ids[size_t(row)]);
+    }
+    rows.erase(size_t(first), size_t(last));
+    rebuildRowIndex();
+    endRemoveRows();
+    last = first;
+  }
+}
+
+void EvidenceTableModel::rebuildRowIndex() {
+  rowIndex.clear();
+  for (size_t row = 0; row < rows.size(); row++) {
+    rowIndex[rows.ids[row]] = int(row);
+  }
+}
+
+std::vector<model::Evidence> EvidenceTableModel::readNextPage() {
+  try {
+    qint64 afterID = (rows.size() == 0) ? 0 : rows.ids.back();
+    auto page =
+        db->getEvidencePage(currentFilters, sortField(sortColumn), sortOrder, afterID, pageSize);
+    allRowsLoaded = page.size() < size_t(pageSize);
+    // evidence whose sort value changed since the last page was read may show up again
+    page.erase(std::remove_if(page.begin(), page.end(),
+                              [this](const model::Evidence& evi) {
+                                return rowIndex.count(evi.id) > 0;
+                              }),
+               page.end());
+    return page;
+  }
+  catch (QSqlError& e) {
+    std::cout << "Could not retrieve evidence. Error: " << e.text().toStdString() << std::endl;
+    allRowsLoaded = true;
+    return {};
+  }
+}
+
+void EvidenceTableModel::appendRows(const std::vector<model::Evidence>& page) {
+  for (const auto& evi : page) {
+    rowIndex[evi.id] = int(rows.size());
+    rows.append(evi);
+  }
+}
+
+int EvidenceTableModel::rowForEvidenceID(qint64 evidenceID) const {
+  auto entry = rowIndex.find(evidenceID);
+  return (entry == rowIndex.end()) ? -1 : entry->second;
+}
+
+void EvidenceTableModel::onEvidenceInserted(qint64 evidenceID) {
+  Q_UNUSED(evidenceID);  // where (or whether) it appears depends on the filters and sort
+  stale = true;
+  refreshTimer->start();
+}
+
+void EvidenceTableModel::onEvidenceUpdated(std::vector<qint64> evidenceIDs) {
+  // the change may also affect which evidence matches the filters, or the sort order. That is left
+  // for the next refresh; only the loaded rows are updated now.
+  stale = true;
+  std::vector<qint64> loadedIDs;
+  for (qint64 evidenceID : evidenceIDs) {
+    if (rowIndex.count(evidenceID) > 0) {
+      loadedIDs.push_back(evidenceID);
+    }
+  }
+  if (loadedIDs.empty()) {
+    return;
+  }
+  pendingUpdates.insert(loadedIDs.begin(), loadedIDs.end());
+  if (!updateWatcher->isRunning()) {
+    readUpdatedRows();
+  }  // otherwise, read once the running read completes (see onUpdatedRowsRead)
+}
+
+void EvidenceTableModel::readUpdatedRows() {
+  if (pendingUpdates.empty()) {
+    return;
+  }
+  std::vector<qint64> evidenceIDs(pendingUpdates.begin(), pendingUpdates.end());
+  pendingUpdates.clear();
+  updateGeneration = generation;
+  updateWatcher->setFuture(dbWorker->run([evidenceIDs](DatabaseConnection* workerDb) {
+    UpdatedRows result;
+    try {
+      result.evidence = workerDb->getEvidenceDetails(evidenceIDs);
+      result.success = true;
+    }
+    catch (QSqlError& e) {
+      std::cout << "Could not refresh table rows: " << e.text().toStdString() << std::endl;
+    }
+    return result;
+  }));
+}
+
+void EvidenceTableModel::onUpdatedRowsRead() {
+  auto result = updateWatcher->result();
+  if (!result.success) {
+    stale = true;  // caught up by the next refresh
+  }
+  else if (updateGeneration == generation) {  // otherwise, the model was reset in the meantime
+    for (const auto& updatedData : result.evidence) {
+      int row = rowForEvidenceID(updatedData.id);
+      if (row == -1) {
+        continue;  // removed while it was being read
+      }
+      rows.set(size_t(row), updatedData);
+      statusText.erase(updatedData.id);
+      emit dataChanged(index(row, 0), index(row, COLUMN_COUNT - 1));
+    }
+  }
+  readUpdatedRows();
+}
+
+void EvidenceTableModel::onEvidenceDeleted(std::vector<qint64> evidenceIDs) {
+  std::unordered_set<qint64> deleted(evidenceIDs.begin(), evidenceIDs.end());
+  removeRowsWhere([&deleted](qint64 evidenceID) { return deleted.count(evidenceID) > 0; });
+}
+
+void EvidenceTableModel::setStatusText(qint64 evidenceID, const QString& text) {
+  int row = rowForEvidenceID(evidenceID);
+  if (row == -1) {
+    return;
+  }
+  auto& current = statusText[evidenceID];
+  if (current != text) {
+    current = text;
+    auto cell = index(row, COL_SUBMITTED);
+    emit dataChanged(cell, cell, {Qt::DisplayRole});
+  }
+}
+
+int EvidenceTableModel::rowCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : int(rows.size());
+}
+
+int EvidenceTableModel::columnCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QString EvidenceTableModel::submittedText(size_t row) const {
+  qint64 evidenceID = rows.ids[row];
+  auto status = statusText.find(evidenceID);
+  if (status != statusText.end()) {
+    return status->second;
+  }
+  if (!rows.uploadDates[row].isNull()) {
+    return "Yes";
+  }
+  if (!rows.nextRetryDates[row].isNull()) {
+    return "Retrying at " + rows.nextRetryDates[row].toLocalTime().toString("hh:mm:ss");
+  }
+  if (rows.queued[row] || uploadQueue->isQueued(evidenceID)) {
+    return "Queued";
+  }
+  return "No";
+}
+
+QVariant EvidenceTableModel::data(const QModelIndex& index, int role) const {
+  static QString dateFormat = QLocale().dateTimeFormat(QLocale::ShortFormat);
+
+  if (!index.isValid() || size_t(index.row()) >= rows.size()) {
+    return QVariant();
+  }
+  auto row = size_t(index.row());
+
+  switch (role) {
+    case ROLE_EVIDENCE_ID:
+      return rows.ids[row];
+    case ROLE_SUBMITTED:
+      return !rows.uploadDates[row].isNull();
+    case Qt::TextAlignmentRole:
+      if (index.column() == COL_SUBMITTED || index.column() == COL_FAILED) {
+        return Qt::AlignCenter;
+      }
+      return QVariant();
+    case Qt::DisplayRole:
+      break;
+    default:
+      return QVariant();
+  }
+
+  switch (index.column()) {
+    case COL_DATE_CAPTURED:
+      return rows.recordedDates[row].toLocalTime().toString(dateFormat);
+    case COL_OPERATION:
+      return rows.operationSlugs[row];
+    case COL_PATH:
+      return QDir::toNativeSeparators(rows.paths[row]);
+    case COL_CONTENT_TYPE:
+      return rows.contentTypes[row];
+    case COL_DESCRIPTION:
+      return rows.descriptions[row];
+    case COL_SUBMITTED:
+      return submittedText(row);
+    case COL_DATE_SUBMITTED:
+      if (rows.uploadDates[row].isNull()) {
+        return "Never";
+      }
+      return rows.uploadDates[row].toLocalTime().toString(dateFormat);
+    case COL_FAILED:
+      return rows.errors[row] == "" ? "" : "Yes";
+    case COL_ERROR_MSG:
+      return rows.errors[row];
+    default:
+      return QVariant();
+  }
+}
+
+QVariant EvidenceTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+    return columnNames().value(section);
+  }
+  return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags EvidenceTableModel::flags(const QModelIndex& index) const {
+  if (!index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+bool EvidenceTableModel::canFetchMore(const QModelIndex& parent) const {
+  if (parent.isValid() || allRowsLoaded) {
+    return false;
+  }
+  if (refreshWatcher->isRunning()) {
+    fetchDeferred = true;  // see onRefreshComplete
+    return false;
+  }
+  return true;
+}
+
+void EvidenceTableModel::fetchMore(const QModelIndex& parent) {
+  if (!canFetchMore(parent)) {
+    return;
+  }
+  auto page = readNextPage();
+  if (page.empty()) {
+    return;
+  }
+  int firstRow = int(rows.size());
+  beginInsertRows(QModelIndex(), firstRow, firstRow + int(page.size()) - 1);
+  appendRows(page);
+  endInsertRows();
+}
+
+void EvidenceTableModel::sort(int column, Qt::SortOrder order) {
+  if (column < 0 || column >= COLUMN_COUNT || (column == sortColumn && order == sortOrder)) {
+    return;
+  }
+  sortColumn = column;
+  sortOrder = order;
+  reload();
+}
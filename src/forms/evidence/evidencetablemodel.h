@@ -0,0 +1,201 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef EVIDENCETABLEMODEL_H
+#define EVIDENCETABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "db/databaseconnection.h"
+#include "db/databaseworker.h"
+#include "forms/evidence_filter/evidencefilter.h"
+#include "helpers/uploadqueue.h"
+#include "models/evidence.h"
+
+/**
+ * @brief The EvidenceTableModel class provides the evidence listed in the Evidence Manager table.
+ * Evidence is read from the database one page at a time (see DatabaseConnection::getEvidencePage),
+ * as the view scrolls toward the end of what has been loaded so far (via canFetchMore/fetchMore).
+ * This way, only the rows a user actually scrolls to are ever read.
+ *
+ * Since rows are loaded in order, sorting is done by the database (via ORDER BY), and changing the
+ * sort simply reloads the model.
+ *
+ * The model follows the database's change signals: loaded rows are updated or removed as their
+ * evidence changes, and new evidence triggers a (debounced) refresh. Refreshes, and updated rows,
+ * are read on the database worker, so that they never block the UI.
+ */
+class EvidenceTableModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ public:
+  enum Column {
+    COL_DATE_CAPTURED = 0,
+    COL_OPERATION,
+    COL_PATH,
+    COL_CONTENT_TYPE,
+    COL_DESCRIPTION,
+    COL_SUBMITTED,
+    COL_DATE_SUBMITTED,
+    COL_FAILED,
+    COL_ERROR_MSG,
+    COLUMN_COUNT
+  };
+
+  /// DataRoles lists the extra (non-display) data available on every cell
+  enum DataRoles {
+    ROLE_EVIDENCE_ID = Qt::UserRole,
+    ROLE_SUBMITTED,
+  };
+
+  explicit EvidenceTableModel(DatabaseConnection* db, DatabaseWorker* dbWorker,
+                              UploadQueue* uploadQueue, QObject* parent = nullptr);
+
+  /// setFilters replaces the model's contents with the first page of evidence matching the given
+  /// filters. If the filters are unchanged, the model is instead refreshed (see refresh), and then
+  /// only if the database has changed since it was last read.
+  void setFilters(const EvidenceFilters& filters);
+  /// refresh re-reads the loaded rows from the database (in the background), then updates the
+  /// model to match, emitting only the row removals, insertions, moves and changes needed to get
+  /// there. Unlike a reset, this keeps the view's selection and scroll position.
+  void refresh();
+  /// filters returns the filters currently applied to the model
+  const EvidenceFilters& filters() const { return currentFilters; }
+
+  /// evidenceAt returns the evidence (including tags) shown in the given (0-based, valid) row.
+  /// Fields not shown in the table (e.g. the content hash) are not populated.
+  model::Evidence evidenceAt(int row) const { return rows.at(size_t(row)); }
+  /// rowForEvidenceID returns the row (0-based) showing the given evidence, or -1 if not loaded
+  int rowForEvidenceID(qint64 evidenceID) const;
+  /// setStatusText replaces the "Submitted" text for the given evidence (e.g. to show upload
+  /// progress), until the evidence is next refreshed
+  void setStatusText(qint64 evidenceID, const QString& text);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+  /// sort reloads the model, sorted by the given column
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+ private slots:
+  void onEvidenceInserted(qint64 evidenceID);
+  void onEvidenceUpdated(std::vector<qint64> evidenceIDs);
+  void onEvidenceDeleted(std::vector<qint64> evidenceIDs);
+  void onRefreshComplete();
+  void onUpdatedRowsRead();
+
+ private:
+  /// reload replaces the model's contents with the first page of evidence
+  void reload();
+  /// readNextPage reads the page of evidence following the last loaded row. Errors are logged, and
+  /// stop any further pages from being read.
+  std::vector<model::Evidence> readNextPage();
+  /// readUpdatedRows re-reads (in the background) the rows listed in pendingUpdates, if any
+  void readUpdatedRows();
+  /// applyRefresh updates the model to match the given (re-read) evidence. limit is the number of
+  /// rows that were asked for.
+  void applyRefresh(const std::vector<model::Evidence>& latest, int limit);
+  /// appendRows adds the given evidence to the end of the model (without notifying views)
+  void appendRows(const std::vector<model::Evidence>& page);
+  /// removeRowsWhere removes every row whose evidence ID matches, notifying views
+  void removeRowsWhere(const std::function<bool(qint64)>& shouldRemove);
+  /// rebuildRowIndex recomputes rowIndex after rows have been inserted, removed or moved. This is
+  /// done before views are notified, so that any lookups they trigger see the new rows.
+  void rebuildRowIndex();
+  /// submittedText returns the text shown in the "Submitted" column for the given row
+  QString submittedText(size_t row) const;
+
+  /// RowCache holds the loaded rows one column at a time (rather than as a model::Evidence per
+  /// row), keeping only the fields the table and editor use.
+  struct RowCache {
+    std::vector<qint64> ids;
+    std::vector<QDateTime> recordedDates;
+    std::vector<QString> operationSlugs;
+    std::vector<QString> paths;
+    std::vector<QString> contentTypes;
+    std::vector<QString> descriptions;
+    std::vector<QString> errors;
+    std::vector<QDateTime> uploadDates;
+    std::vector<QDateTime> nextRetryDates;
+    std::vector<bool> queued;
+    std::vector<std::vector<model::Tag>> tags;
+
+    size_t size() const { return ids.size(); }
+    void clear();
+    void append(const model::Evidence& evi);
+    void set(size_t row, const model::Evidence& evi);
+    void insert(size_t row, const model::Evidence& evi);
+    void erase(size_t first, size_t last);
+    void move(size_t from, size_t to);
+    model::Evidence at(size_t row) const;
+    /// matches returns true if the given row already holds the (cached fields of the) evidence
+    bool matches(size_t row, const model::Evidence& evi) const;
+  };
+
+ private:
+  /// db is a (shared) reference to the local database instance. Not to be deleted.
+  DatabaseConnection* db;
+  /// dbWorker is a (shared) reference to the database worker. Not to be deleted.
+  DatabaseWorker* dbWorker;
+  /// uploadQueue is a (shared) reference to the background upload queue. Not to be deleted.
+  UploadQueue* uploadQueue;
+
+  EvidenceFilters currentFilters;
+  int sortColumn = COL_DATE_CAPTURED;
+  Qt::SortOrder sortOrder = Qt::DescendingOrder;
+  /// allRowsLoaded is true once the last page of evidence has been read
+  bool allRowsLoaded = true;
+  /// loaded is true once the model has been populated (see setFilters)
+  bool loaded = false;
+  /// stale is true if the database has changed since the model was last (re)loaded
+  bool stale = false;
+  /// refreshTimer delays refreshing after new evidence is saved (see onEvidenceInserted)
+  QTimer* refreshTimer = nullptr;
+
+  /// RefreshResult is the outcome of the (background) query made by refresh
+  struct RefreshResult {
+    bool success = false;
+    int limit = 0;
+    std::vector<model::Evidence> evidence;
+  };
+  QFutureWatcher<RefreshResult>* refreshWatcher = nullptr;
+  /// refreshQueued is true if another refresh was requested while one was running
+  bool refreshQueued = false;
+  /// fetchDeferred is true if the view asked for more rows while a refresh was running. The rows
+  /// are fetched once the refresh completes, so that the page starts after the refreshed rows.
+  mutable bool fetchDeferred = false;
+
+  /// UpdatedRows is the outcome of the (background) query made by readUpdatedRows
+  struct UpdatedRows {
+    bool success = false;
+    std::vector<model::Evidence> evidence;
+  };
+  QFutureWatcher<UpdatedRows>* updateWatcher = nullptr;
+  /// pendingUpdates holds the loaded evidence changed since the last read of updated rows. Changes
+  /// announced while a read is running are collected here, and read together once it completes.
+  std::unordered_set<qint64> pendingUpdates;
+  /// generation counts resets, so that a refresh started before a reset can be discarded
+  quint64 generation = 0;
+  quint64 refreshGeneration = 0;
+  quint64 updateGeneration = 0;
+
+  RowCache rows;
+  /// rowIndex maps each loaded evidence ID to its row in rows
+  std::unordered_map<qint64, int> rowIndex;
+  /// statusText holds any replacement "Submitted" text (see setStatusText)
+  std::unordered_map<qint64, QString> statusText;
+};
+
+#endif  // EVIDENCETABLEMODEL_H
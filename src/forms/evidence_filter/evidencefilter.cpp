@@ -27,6 +27,12 @@ QString EvidenceFilters::standardizeFilterKey(QString key) {
   if (FILTER_KEYS_CONTENT_TYPE.contains(key, Qt::CaseInsensitive)) {
     return FILTER_KEY_CONTENT_TYPE;
   }
+  if (FILTER_KEYS_SERIES.contains(key, Qt::CaseInsensitive)) {
+    return FILTER_KEY_SERIES;
+  }
+  if (FILTER_KEYS_SIMILAR.contains(key, Qt::CaseInsensitive)) {
+    return FILTER_KEY_SIMILAR;
+  }
   return key;
 }
 
@@ -71,6 +77,12 @@ QString EvidenceFilters::toString() const {
   if (submitted != Any) {
     rtn.append(" " + FILTER_KEY_SUBMITTED + ": " + triToText(submitted));
   }
+  if (seriesID > 0) {
+    rtn.append(" " + FILTER_KEY_SERIES + ": " + QString::number(seriesID));
+  }
+  if (similarTo > 0) {
+    rtn.append(" " + FILTER_KEY_SIMILAR + ": " + QString::number(similarTo));
+  }
 
   return rtn.trimmed();
 }
@@ -112,6 +124,12 @@ EvidenceFilters EvidenceFilters::parseFilter(const QString& text) {
     else if (key == FILTER_KEY_CONTENT_TYPE) {
       filter.contentType = value;
     }
+    else if (key == FILTER_KEY_SERIES) {
+      filter.seriesID = value.toLongLong();
+    }
+    else if (key == FILTER_KEY_SIMILAR) {
+      filter.similarTo = value.toLongLong();
+    }
   }
 
   return filter;
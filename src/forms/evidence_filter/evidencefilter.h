@@ -19,6 +19,8 @@ const QString FILTER_KEY_FROM = "from";
 const QString FILTER_KEY_ON = "on";
 const QString FILTER_KEY_OPERATION = "op";
 const QString FILTER_KEY_CONTENT_TYPE = "type";
+const QString FILTER_KEY_SERIES = "series";
+const QString FILTER_KEY_SIMILAR = "similar";
 
 // These represent aliases for standard key for a filter
 const QStringList FILTER_KEYS_ERROR = {FILTER_KEY_ERROR, "error", "failed", "fail"};
@@ -28,6 +30,8 @@ const QStringList FILTER_KEYS_FROM = {FILTER_KEY_FROM, "after"};
 const QStringList FILTER_KEYS_ON = {FILTER_KEY_ON};
 const QStringList FILTER_KEYS_OPERATION = {FILTER_KEY_OPERATION, "operation"};
 const QStringList FILTER_KEYS_CONTENT_TYPE = {FILTER_KEY_CONTENT_TYPE, "contentType"};
+const QStringList FILTER_KEYS_SERIES = {FILTER_KEY_SERIES, "burst"};
+const QStringList FILTER_KEYS_SIMILAR = {FILTER_KEY_SIMILAR, "like"};
 
 class EvidenceFilters {
  public:
@@ -44,6 +48,8 @@ class EvidenceFilters {
   Tri submitted = Any;
   QDate startDate = QDate();
   QDate endDate = QDate();
+  qint64 seriesID = 0;
+  qint64 similarTo = 0;
 
  public:
   static Tri parseTri(const QString &text);
@@ -184,6 +184,8 @@ EvidenceFilters EvidenceFilterForm::encodeForm() {
   filter.submitted = EvidenceFilters::parseTri(submittedComboBox->currentText());
   filter.operationSlug = operationComboBox->currentData().toString();
   filter.contentType = contentTypeComboBox->currentData().toString();
+  filter.seriesID = seriesID;
+  filter.similarTo = similarTo;
 
   // swap dates so smaller date is always "from" / after
   if (fromDateEdit->isEnabled() && toDateEdit->isEnabled() &&
@@ -204,6 +206,8 @@ EvidenceFilters EvidenceFilterForm::encodeForm() {
 }
 
 void EvidenceFilterForm::setForm(const EvidenceFilters &model) {
+  seriesID = model.seriesID;
+  similarTo = model.similarTo;
   UiHelpers::setComboBoxValue(operationComboBox, model.operationSlug);
   UiHelpers::setComboBoxValue(contentTypeComboBox, model.contentType);
   erroredComboBox->setCurrentText(EvidenceFilters::triToString(model.hasError));
@@ -51,6 +51,10 @@ class EvidenceFilterForm : public QDialog {
 
  private:
   QAction* closeWindowAction = nullptr;
+  /// seriesID and similarTo carry the series and similar filters (which can only be typed, not
+  /// picked on the form) through the form, so that editing other filters does not drop them
+  qint64 seriesID = 0;
+  qint64 similarTo = 0;
 
   // UI Components
   QGridLayout* gridLayout = nullptr;
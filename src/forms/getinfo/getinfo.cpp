@@ -3,18 +3,20 @@
 
 #include "getinfo.h"
 
+#include <QFile>
 #include <QKeySequence>
 #include <QMessageBox>
+#include <iostream>
 
 #include "appsettings.h"
 #include "components/evidence_editor/evidenceeditor.h"
-#include "helpers/netman.h"
-#include "helpers/stopreply.h"
 #include "helpers/ui_helpers.h"
 
-GetInfo::GetInfo(DatabaseConnection* db, qint64 evidenceID, QWidget* parent)
-    : QDialog(parent), db(db), evidenceID(evidenceID) {
+GetInfo::GetInfo(DatabaseConnection* db, UploadQueue* uploadQueue, qint64 evidenceID,
+                 QWidget* parent)
+    : QDialog(parent), db(db), uploadQueue(uploadQueue), evidenceID(evidenceID) {
   this->db = db;
+  this->uploadQueue = uploadQueue;
   this->evidenceID = evidenceID;
 
   buildUi();
@@ -28,7 +30,6 @@ GetInfo::~GetInfo() {
   delete closeWindowAction;
 
   delete gridLayout;
-  stopReply(&uploadAssetReply);
 }
 
 void GetInfo::buildUi() {
@@ -83,6 +84,8 @@ void GetInfo::wireUi() {
   connect(submitButton, &QPushButton::clicked, this, &GetInfo::submitButtonClicked);
   connect(deleteButton, &QPushButton::clicked, this, &GetInfo::deleteButtonClicked);
   connect(closeWindowAction, &QAction::triggered, this, &GetInfo::deleteButtonClicked);
+  connect(uploadQueue, &UploadQueue::uploadFinished, this, &GetInfo::onUploadComplete);
+  connect(uploadQueue, &UploadQueue::uploadRetryScheduled, this, &GetInfo::onUploadRetryScheduled);
 }
 
 void GetInfo::showEvent(QShowEvent* evt) {
@@ -105,17 +108,70 @@ bool GetInfo::saveData() {
 void GetInfo::submitButtonClicked() {
   submitButton->startAnimation();
   setActionButtonsEnabled(false);
-  if (saveData()) {
-    try {
-      model::Evidence evi = db->getEvidenceDetails(evidenceID);
-      uploadAssetReply = NetMan::getInstance().uploadAsset(evi);
-      connect(uploadAssetReply, &QNetworkReply::finished, this, &GetInfo::onUploadComplete);
+  if (!saveData()) {
+    submitButton->stopAnimation();
+    setActionButtonsEnabled(true);
+    return;
+  }
+  if (!useDuplicateIfPreferred()) {
+    uploadQueue->enqueue(evidenceID, UploadQueue::PRIORITY_HIGH);
+    if (uploadQueue->isPaused()) {
+      // nothing will be uploaded until we're back online, so don't leave the user waiting on it
+      submitButton->stopAnimation();
+      setActionButtonsEnabled(true);
+      showQueuedNotice();
+      this->close();
     }
-    catch (QSqlError& e) {
-      QMessageBox::warning(this, "Cannot submit evidence",
-                           "Could not retrieve data. Please try again.");
+  }
+}
+
+void GetInfo::showQueuedNotice() {
+  QMessageBox::information(this, "Upload Queued",
+                           "You are currently offline, so this evidence has been saved and queued. "
+                           "It will be uploaded automatically once you are back online, and its "
+                           "status can be seen in the evidence manager.");
+}
+
+bool GetInfo::useDuplicateIfPreferred() {
+  model::Evidence duplicate;
+  try {
+    duplicate = db->findDuplicateEvidence(db->getEvidenceDetails(evidenceID));
+  }
+  catch (QSqlError& e) {
+    std::cout << "Could not check for duplicate evidence. Error: " << e.text().toStdString()
+              << std::endl;
+  }
+  if (duplicate.id == 0) {
+    return false;
+  }
+
+  bool wasSubmitted = !duplicate.uploadDate.isNull();
+  bool isQueued = uploadQueue->isQueued(duplicate.id);
+  QString status = wasSubmitted ? "and has already been submitted"
+                   : isQueued   ? "and is waiting to be submitted"
+                                : "but has not been submitted";
+  auto reply = QMessageBox::question(
+      this, "Duplicate Evidence",
+      "Identical evidence was captured for this operation on " +
+          duplicate.recordedDate.toLocalTime().toString("MMM dd, yyyy hh:mm") + ", " + status +
+          ".\n\nUse the existing evidence instead of uploading this copy? This copy (including its "
+          "description and tags) will be discarded.",
+      QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+  if (reply != QMessageBox::Yes) {
+    return false;
+  }
+
+  if (!wasSubmitted) {
+    uploadQueue->enqueue(duplicate.id, UploadQueue::PRIORITY_HIGH);
+  }
+  submitButton->stopAnimation();
+  if (discardEvidence()) {
+    if (!wasSubmitted && uploadQueue->isPaused()) {
+      showQueuedNotice();
     }
+    this->close();
   }
+  return true;
 }
 
 void GetInfo::deleteButtonClicked() {
@@ -123,31 +179,33 @@ void GetInfo::deleteButtonClicked() {
                                      "Are you sure you want to discard this evidence?",
                                      QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
 
-  if (reply == QMessageBox::Yes) {
-    setActionButtonsEnabled(false);
-    bool shouldClose = true;
-
-    model::Evidence evi = evidenceEditor->encodeEvidence();
-    if (!QFile::remove(evi.path)) {
-      QMessageBox::warning(this, "Could not delete",
-                           "Unable to delete evidence file.\n"
-                           "You can try deleting the file directly. File Location:\n" +
-                               evi.path);
-      shouldClose = false;
-    }
-    try {
-      db->deleteEvidence(evidenceID);
-    }
-    catch (QSqlError& e) {
-      std::cout << "Could not delete evidence from internal database. Error: "
-                << e.text().toStdString() << std::endl;
-    }
+  if (reply == QMessageBox::Yes && discardEvidence()) {
+    this->close();
+  }
+}
 
-    setActionButtonsEnabled(true);
-    if (shouldClose) {
-      this->close();
-    }
+bool GetInfo::discardEvidence() {
+  setActionButtonsEnabled(false);
+  bool shouldClose = true;
+
+  model::Evidence evi = evidenceEditor->encodeEvidence();
+  if (!QFile::remove(evi.path)) {
+    QMessageBox::warning(this, "Could not delete",
+                         "Unable to delete evidence file.\n"
+                         "You can try deleting the file directly. File Location:\n" +
+                             evi.path);
+    shouldClose = false;
+  }
+  try {
+    db->deleteEvidence(evidenceID);
+  }
+  catch (QSqlError& e) {
+    std::cout << "Could not delete evidence from internal database. Error: "
+              << e.text().toStdString() << std::endl;
   }
+
+  setActionButtonsEnabled(true);
+  return shouldClose;
 }
 
 void GetInfo::setActionButtonsEnabled(bool enabled) {
@@ -155,38 +213,49 @@ void GetInfo::setActionButtonsEnabled(bool enabled) {
   deleteButton->setEnabled(enabled);
 }
 
-void GetInfo::onUploadComplete() {
-  if (uploadAssetReply->error() != QNetworkReply::NoError) {
-    auto errMessage =
-        "Unable to upload evidence: Network error (" + uploadAssetReply->errorString() + ")";
-    try {
-      db->updateEvidenceError(errMessage, this->evidenceID);
-    }
-    catch (QSqlError& e) {
-      std::cout << "Upload failed. Could not update internal database. Error: "
-                << e.text().toStdString() << std::endl;
-    }
+void GetInfo::onUploadComplete(qint64 uploadedEvidenceID, bool success, QString errorText) {
+  if (uploadedEvidenceID != evidenceID) {
+    return;
+  }
+
+  if (!success) {
     QMessageBox::warning(this, "Cannot submit evidence",
                          "Upload failed: Network error. Check your connection and try again.\n"
                          "Note: This evidence has been saved. You can close this window and "
                          "re-submit from the evidence manager."
                          "\n(Error: " +
-                             uploadAssetReply->errorString() + ")");
+                             errorText + ")");
   }
   else {
     try {
-      db->updateEvidenceSubmitted(this->evidenceID);
       emit evidenceSubmitted(db->getEvidenceDetails(this->evidenceID));
       this->close();
     }
     catch (QSqlError& e) {
-      std::cout << "Upload successful. Could not update internal database. Error: "
+      std::cout << "Upload successful. Could not read internal database. Error: "
                 << e.text().toStdString() << std::endl;
     }
   }
-  // we don't actually need anything from the uploadAssets reply, so just clean it up.
-  // one thing we might want to record: evidence uuid... not sure why we'd need it though.
   submitButton->stopAnimation();
   setActionButtonsEnabled(true);
-  tidyReply(&uploadAssetReply);
+}
+
+void GetInfo::onUploadRetryScheduled(qint64 uploadedEvidenceID, int attempt, QDateTime nextAttempt,
+                                     QString errorText) {
+  Q_UNUSED(attempt);
+  if (uploadedEvidenceID != evidenceID) {
+    return;
+  }
+
+  // the evidence is saved and will be retried in the background; nothing more to do here
+  QMessageBox::information(this, "Upload will be retried",
+                           "Upload failed: Network error. The upload will be retried "
+                           "automatically at " +
+                               nextAttempt.toLocalTime().toString("hh:mm:ss") +
+                               ", and its status can be seen in the evidence manager."
+                               "\n(Error: " +
+                               errorText + ")");
+  submitButton->stopAnimation();
+  setActionButtonsEnabled(true);
+  this->close();
 }
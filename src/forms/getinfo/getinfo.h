@@ -7,13 +7,13 @@
 #include <QGridLayout>
 #include <QAction>
 #include <QDialog>
-#include <QNetworkReply>
 
 #include "components/evidence_editor/evidenceeditor.h"
 #include "components/loading/qprogressindicator.h"
 #include "components/loading_button/loadingbutton.h"
 #include "db/databaseconnection.h"
 #include "dtos/tag.h"
+#include "helpers/uploadqueue.h"
 
 namespace Ui {
 class GetInfo;
@@ -23,13 +23,24 @@ class GetInfo : public QDialog {
   Q_OBJECT
 
  public:
-  explicit GetInfo(DatabaseConnection *db, qint64 evidenceID, QWidget *parent = nullptr);
+  explicit GetInfo(DatabaseConnection *db, UploadQueue *uploadQueue, qint64 evidenceID,
+                   QWidget *parent = nullptr);
   ~GetInfo();
 
  private:
   void buildUi();
   void wireUi();
   bool saveData();
+  /// discardEvidence deletes this evidence's file and database record. Returns true if the window
+  /// should close (i.e. the file was deleted)
+  bool discardEvidence();
+  /// useDuplicateIfPreferred checks whether identical evidence already exists for this operation,
+  /// and if so, offers to use that evidence instead of uploading this copy. Returns true if the
+  /// user accepted (in which case this copy has been discarded)
+  bool useDuplicateIfPreferred();
+  /// showQueuedNotice tells the user that the evidence will be uploaded later, as uploads are
+  /// currently paused (i.e. offline, or working offline)
+  void showQueuedNotice();
   void setActionButtonsEnabled(bool enabled);
 
   void showEvent(QShowEvent *evt) override;
@@ -38,7 +49,9 @@ class GetInfo : public QDialog {
   void submitButtonClicked();
   void deleteButtonClicked();
 
-  void onUploadComplete();
+  void onUploadComplete(qint64 uploadedEvidenceID, bool success, QString errorText);
+  void onUploadRetryScheduled(qint64 uploadedEvidenceID, int attempt, QDateTime nextAttempt,
+                              QString errorText);
 
  public:
  signals:
@@ -46,10 +59,10 @@ class GetInfo : public QDialog {
 
  private:
   DatabaseConnection *db;
+  /// uploadQueue is a (shared) reference to the background upload queue. Not to be deleted.
+  UploadQueue *uploadQueue;
   qint64 evidenceID;
 
-  QNetworkReply *uploadAssetReply = nullptr;
-
   // Actions
   QAction* closeWindowAction = nullptr;
 
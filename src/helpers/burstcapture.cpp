@@ -0,0 +1,131 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "burstcapture.h"
+
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iostream>
+
+#include "helpers/file_helpers.h"
+#include "helpers/perceptualhash.h"
+
+BurstCapture::BurstCapture(QObject* parent) : QObject(parent) {
+  frameTimer = new QTimer(this);
+  connect(frameTimer, &QTimer::timeout, this, &BurstCapture::captureFrame);
+}
+
+BurstCapture::~BurstCapture() {
+  // in-flight encodes finish on their own; their results are simply discarded
+  frameTimer->stop();
+}
+
+void BurstCapture::start(int frameCount, int intervalMs, int bufferFrames) {
+  if (running) {
+    std::cout << "A burst capture is already in progress; ignoring new burst request" << std::endl;
+    return;
+  }
+  running = true;
+  framesRemaining = std::max(1, frameCount);
+  framesInFlight = 0;
+  maxFramesInFlight = std::max(1, QThread::idealThreadCount());
+  droppedFrames = 0;
+  ring.assign(size_t(std::max(1, bufferFrames)), Frame{0, QImage()});
+  ringHead = 0;
+  ringCount = 0;
+  stored.assign(size_t(framesRemaining), model::Evidence());
+
+  // read once, so that every frame lands in the same place, in the same format
+  encoding = CaptureEncoding::fromConfig();
+  evidenceDir = FileHelpers::pathToEvidence();
+
+  captureFrame();
+  if (framesRemaining > 0) {
+    frameTimer->start(std::max(1, intervalMs));
+  }
+}
+
+void BurstCapture::captureFrame() {
+  int index = int(stored.size()) - framesRemaining;
+  framesRemaining--;
+  if (framesRemaining == 0) {
+    frameTimer->stop();
+  }
+
+  auto image = Screenshot::screenUnderCursor()->grabWindow(0).toImage();
+  if (image.isNull()) {
+    droppedFrames++;
+  }
+  else {
+    if (ringCount == ring.size()) {
+      // encoders have fallen behind; make room by dropping the oldest waiting frame
+      ring[ringHead].image = QImage();
+      ringHead = (ringHead + 1) % ring.size();
+      ringCount--;
+      droppedFrames++;
+    }
+    ring[(ringHead + ringCount) % ring.size()] = Frame{index, image};
+    ringCount++;
+  }
+  encodeWaitingFrames();
+  finishIfDone();
+}
+
+void BurstCapture::encodeWaitingFrames() {
+  while (ringCount > 0 && framesInFlight < maxFramesInFlight) {
+    Frame frame = ring[ringHead];
+    ring[ringHead].image = QImage();  // release the ring's copy of the frame
+    ringHead = (ringHead + 1) % ring.size();
+    ringCount--;
+    framesInFlight++;
+
+    auto watcher = new QFutureWatcher<model::Evidence>(this);
+    int index = frame.index;
+    connect(watcher, &QFutureWatcher<model::Evidence>::finished, this, [this, watcher, index]() {
+      auto result = watcher->result();
+      watcher->deleteLater();
+      onFrameEncoded(index, result);
+    });
+    watcher->setFuture(
+        QtConcurrent::run(&BurstCapture::encodeFrame, frame.image, encoding, evidenceDir));
+  }
+}
+
+void BurstCapture::onFrameEncoded(int index, const model::Evidence& frame) {
+  framesInFlight--;
+  if (frame.path.isEmpty()) {
+    droppedFrames++;
+  }
+  stored[size_t(index)] = frame;
+  encodeWaitingFrames();
+  finishIfDone();
+}
+
+void BurstCapture::finishIfDone() {
+  if (framesRemaining > 0 || ringCount > 0 || framesInFlight > 0) {
+    return;
+  }
+  running = false;
+
+  std::vector<model::Evidence> frames;
+  for (const auto& frame : stored) {
+    if (!frame.path.isEmpty()) {
+      frames.push_back(frame);
+    }
+  }
+  stored.clear();
+  emit burstCaptured(frames, droppedFrames);
+}
+
+model::Evidence BurstCapture::encodeFrame(QImage image, const CaptureEncoding& encoding,
+                                          const QString& evidenceDir) {
+  model::Evidence frame;
+  frame.path = Screenshot::writeToEvidence(image, encoding, evidenceDir);
+  if (!frame.path.isEmpty()) {
+    frame.contentHash = FileHelpers::sha256File(frame.path);
+    frame.perceptualHash = PerceptualHash::dHash(image);
+  }
+  return frame;
+}
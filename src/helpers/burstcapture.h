@@ -0,0 +1,81 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef BURSTCAPTURE_H
+#define BURSTCAPTURE_H
+
+#include <QImage>
+#include <QObject>
+#include <QTimer>
+#include <vector>
+
+#include "helpers/screenshot.h"
+#include "models/evidence.h"
+
+/**
+ * @brief The BurstCapture class captures a series of frames (of the screen under the cursor) at a
+ * fixed interval, for recording fast-moving activity that a single capture would miss.
+ *
+ * Grabbing a frame is quick, but encoding it is not, so grabbed frames wait in a bounded ring of
+ * frames until an encoder (on the global thread pool) is free. If encoding falls too far behind,
+ * the oldest waiting frame is dropped, rather than letting memory grow without limit.
+ *
+ * Once every frame has been stored, burstCaptured is emitted with all of them, so that they can be
+ * saved together (see DatabaseConnection::createEvidenceSeries).
+ */
+class BurstCapture : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit BurstCapture(QObject* parent = nullptr);
+  ~BurstCapture();
+
+  /// start captures frameCount frames, intervalMs milliseconds apart, holding at most bufferFrames
+  /// frames in memory while they wait to be encoded. Ignored if a burst is already running.
+  void start(int frameCount, int intervalMs, int bufferFrames);
+  /// isRunning returns true while a burst is being captured or stored
+  bool isRunning() const { return running; }
+
+ signals:
+  /// burstCaptured is emitted once every frame has been stored. The frames (in capture order) have
+  /// their path, content hash and perceptual hash set. Dropped or unwritable frames are left out.
+  void burstCaptured(std::vector<model::Evidence> frames, int droppedFrames);
+
+ private:
+  void captureFrame();
+  /// encodeWaitingFrames starts encoding waiting frames, while encoders are free
+  void encodeWaitingFrames();
+  void onFrameEncoded(int index, const model::Evidence& frame);
+  void finishIfDone();
+
+  /// encodeFrame stores the given frame, and computes its content and perceptual hashes. Safe to
+  /// run on any thread.
+  static model::Evidence encodeFrame(QImage image, const CaptureEncoding& encoding,
+                                     const QString& evidenceDir);
+
+ private:
+  QTimer* frameTimer = nullptr;
+  bool running = false;
+
+  /// Frame is a grabbed (but not yet encoded) frame
+  struct Frame {
+    int index;
+    QImage image;
+  };
+  /// ring holds the frames waiting to be encoded: ringCount frames, starting at ringHead
+  std::vector<Frame> ring;
+  size_t ringHead = 0;
+  size_t ringCount = 0;
+
+  int framesRemaining = 0;
+  int framesInFlight = 0;
+  int maxFramesInFlight = 1;
+  int droppedFrames = 0;
+  /// stored holds the result for each frame, by capture index
+  std::vector<model::Evidence> stored;
+
+  CaptureEncoding encoding;
+  QString evidenceDir;
+};
+
+#endif  // BURSTCAPTURE_H
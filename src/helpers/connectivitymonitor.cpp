@@ -0,0 +1,81 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "connectivitymonitor.h"
+
+#include "appconfig.h"
+#include "appsettings.h"
+#include "helpers/netman.h"
+#include "helpers/stopreply.h"
+
+// probeInterval is how often (in milliseconds) the server is checked
+static const int probeInterval = 30 * 1000;
+
+ConnectivityMonitor::ConnectivityMonitor(QObject* parent) : QObject(parent) {
+  probeTimer = new QTimer(this);
+  connect(probeTimer, &QTimer::timeout, this, &ConnectivityMonitor::checkNow);
+
+  if (isOfflineMode()) {
+    online = false;
+  }
+  else {
+    probeTimer->start(probeInterval);
+    QTimer::singleShot(0, this, &ConnectivityMonitor::checkNow);
+  }
+}
+
+ConnectivityMonitor::~ConnectivityMonitor() { cancelProbe(); }
+
+bool ConnectivityMonitor::isOfflineMode() { return AppSettings::getInstance().offlineMode(); }
+
+void ConnectivityMonitor::setOfflineMode(bool offline) {
+  AppSettings::getInstance().setOfflineMode(offline);
+  if (offline) {
+    probeTimer->stop();
+    cancelProbe();
+    setOnline(false);
+  }
+  else {
+    probeTimer->start(probeInterval);
+    checkNow();
+  }
+}
+
+void ConnectivityMonitor::checkNow() {
+  if (probeReply != nullptr || isOfflineMode()) {
+    return;
+  }
+  AppConfig& conf = AppConfig::getInstance();
+  if (conf.apiURL == "") {
+    setOnline(false);
+    return;
+  }
+  probeReply = NetMan::getInstance().testConnection(conf.apiURL, conf.accessKey, conf.secretKey);
+  connect(probeReply, &QNetworkReply::finished, this, &ConnectivityMonitor::onProbeComplete);
+}
+
+void ConnectivityMonitor::onProbeComplete() {
+  // any (non-gateway) response means the server is reachable; whether the credentials are valid is
+  // left to the actual requests to report
+  int statusCode = probeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  bool reachable = statusCode != 0 && statusCode < 500;
+  tidyReply(&probeReply);
+
+  if (!isOfflineMode()) {
+    setOnline(reachable);
+  }
+}
+
+void ConnectivityMonitor::cancelProbe() {
+  if (probeReply != nullptr) {
+    probeReply->disconnect(this);  // aborting emits finished; the result is not wanted
+  }
+  stopReply(&probeReply);
+}
+
+void ConnectivityMonitor::setOnline(bool online) {
+  if (this->online != online) {
+    this->online = online;
+    emit connectivityChanged(online);
+  }
+}
@@ -0,0 +1,54 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef CONNECTIVITYMONITOR_H
+#define CONNECTIVITYMONITOR_H
+
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @brief The ConnectivityMonitor class tracks whether the configured ASHIRT server is reachable, by
+ * periodically probing /api/checkconnection (see NetMan::testConnection).
+ *
+ * The user may also choose to work offline (see setOfflineMode). In this case, no probes are sent,
+ * and the monitor always reports being offline. This choice is remembered between launches.
+ */
+class ConnectivityMonitor : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit ConnectivityMonitor(QObject* parent = nullptr);
+  ~ConnectivityMonitor();
+
+  /// isOnline returns true if the server was reachable at the last check (and offline mode is off).
+  /// The server is assumed to be reachable until a check shows otherwise.
+  bool isOnline() { return online; }
+  /// isOfflineMode returns true if the user has chosen to work offline
+  bool isOfflineMode();
+  /// setOfflineMode enables or disables working offline. Disabling offline mode triggers an
+  /// immediate check.
+  void setOfflineMode(bool offline);
+
+ public slots:
+  /// checkNow probes the server immediately (unless a probe is already in flight, or offline mode
+  /// is enabled)
+  void checkNow();
+
+ signals:
+  /// connectivityChanged is emitted whenever the server becomes reachable, or unreachable
+  void connectivityChanged(bool online);
+
+ private:
+  void onProbeComplete();
+  void cancelProbe();
+  void setOnline(bool online);
+
+ private:
+  QTimer* probeTimer = nullptr;
+  QNetworkReply* probeReply = nullptr;
+  bool online = true;
+};
+
+#endif  // CONNECTIVITYMONITOR_H
@@ -1,6 +1,7 @@
 #ifndef FILE_HELPERS_H
 #define FILE_HELPERS_H
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QIODevice>
@@ -105,6 +106,18 @@ class FileHelpers {
     }
     return data;
   }
+
+  /// sha256File computes the (hex-encoded) SHA-256 digest of the file at the given path, reading
+  /// it in chunks rather than all at once. Returns an empty string if the file cannot be read.
+  /// Safe to call from a worker thread.
+  static QString sha256File(QString path) {
+    QFile file(path);
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hasher.addData(&file)) {
+      return "";
+    }
+    return QString::fromLatin1(hasher.result().toHex());
+  }
 };
 
 #endif  // FILE_HELPERS_H
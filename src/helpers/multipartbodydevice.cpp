@@ -0,0 +1,91 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "multipartbodydevice.h"
+
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+#include "helpers/file_helpers.h"
+
+MultipartBodyDevice::MultipartBodyDevice(MultipartParser& parser, QObject* parent)
+    : QIODevice(parent) {
+  for (const auto& segment : parser.GenBodySegments()) {
+    Section section;
+    section.start = totalSize;
+    if (segment.is_file) {
+      auto path = QString::fromStdString(segment.data);
+      section.file = new QFile(path, this);
+      section.length = QFileInfo(path).size();
+    }
+    else {
+      section.literal = FileHelpers::stdStringToByteArray(segment.data);
+      section.length = section.literal.size();
+    }
+    totalSize += section.length;
+    sections.push_back(section);
+  }
+}
+
+MultipartBodyDevice::~MultipartBodyDevice() { close(); }
+
+bool MultipartBodyDevice::open(OpenMode mode) {
+  if ((mode & QIODevice::ReadWrite) != QIODevice::ReadOnly) {
+    setErrorString("MultipartBodyDevice is read-only");
+    return false;
+  }
+  for (auto& section : sections) {
+    if (section.file != nullptr && !section.file->open(QIODevice::ReadOnly)) {
+      setErrorString(section.file->fileName() + ": " + section.file->errorString());
+      close();
+      return false;
+    }
+  }
+  // reads are served straight from the sections; no need for QIODevice to buffer them again
+  return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void MultipartBodyDevice::close() {
+  for (auto& section : sections) {
+    if (section.file != nullptr) {
+      section.file->close();
+    }
+  }
+  QIODevice::close();
+}
+
+qint64 MultipartBodyDevice::readData(char* data, qint64 maxSize) {
+  qint64 offset = pos();
+  qint64 copied = 0;
+
+  for (auto& section : sections) {
+    if (copied == maxSize) {
+      break;
+    }
+    if (offset >= section.start + section.length) {
+      continue;  // already past this section
+    }
+    qint64 within = offset - section.start;
+    qint64 want = std::min(maxSize - copied, section.length - within);
+
+    if (section.file == nullptr) {
+      std::memcpy(data + copied, section.literal.constData() + within, size_t(want));
+    }
+    else {
+      if (!section.file->seek(within) || section.file->read(data + copied, want) != want) {
+        setErrorString(section.file->fileName() + ": " + section.file->errorString());
+        return -1;
+      }
+    }
+    copied += want;
+    offset += want;
+  }
+  return copied;
+}
+
+qint64 MultipartBodyDevice::writeData(const char* data, qint64 maxSize) {
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return -1;
+}
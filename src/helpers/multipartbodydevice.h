@@ -0,0 +1,58 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef MULTIPARTBODYDEVICE_H
+#define MULTIPARTBODYDEVICE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <vector>
+
+#include "helpers/multipartparser.h"
+
+/**
+ * @brief The MultipartBodyDevice class is a read-only, random-access QIODevice that presents a
+ * multipart/form-data body (as described by a MultipartParser) without materializing it in memory.
+ * Boundaries, headers and parameter values are kept in memory, while file contents are read from
+ * disk only as the reader asks for them. This keeps memory usage flat regardless of file size.
+ *
+ * The total size is known up front, so the device can be handed directly to
+ * QNetworkAccessManager::post (see RequestBuilder::setBodyDevice).
+ */
+class MultipartBodyDevice : public QIODevice {
+  Q_OBJECT
+
+ public:
+  /// MultipartBodyDevice constructs a device over the body described by the given parser. No files
+  /// are opened until open is called.
+  explicit MultipartBodyDevice(MultipartParser& parser, QObject* parent = nullptr);
+  ~MultipartBodyDevice() override;
+
+  /// open opens the device, along with each of the underlying files. Only ReadOnly is supported.
+  /// Returns false (and sets the error string) if any file cannot be opened.
+  bool open(OpenMode mode) override;
+  /// close closes the device, along with each of the underlying files.
+  void close() override;
+
+  bool isSequential() const override { return false; }
+  qint64 size() const override { return totalSize; }
+
+ protected:
+  qint64 readData(char* data, qint64 maxSize) override;
+  qint64 writeData(const char* data, qint64 maxSize) override;
+
+ private:
+  /// Section is a contiguous portion of the body. Exactly one of literal / file is used.
+  struct Section {
+    QByteArray literal;
+    QFile* file = nullptr;
+    qint64 start = 0;
+    qint64 length = 0;
+  };
+
+  std::vector<Section> sections;
+  qint64 totalSize = 0;
+};
+
+#endif  // MULTIPARTBODYDEVICE_H
@@ -13,8 +13,8 @@
 
 #include <algorithm>
 #include <fstream>
-#include <future>
 #include <iostream>
+#include <iterator>
 
 const std::string MultipartParser::boundary_prefix_("----ASHIRTTrayApp");
 const std::string MultipartParser::rand_chars_(
@@ -33,52 +33,53 @@ MultipartParser::MultipartParser() {
 }
 
 const std::string &MultipartParser::GenBodyContent() {
-  std::vector<std::future<std::string>> futures;
   body_content_.clear();
-  for (auto &file : files_) {
-    std::future<std::string> content_futures = std::async(std::launch::async, [&file]() {
-      std::ifstream ifile(file.second, std::ios::binary | std::ios::ate);
-      std::streamsize size = ifile.tellg();
-      ifile.seekg(0, std::ios::beg);
-      char *buff = new char[size];
-      ifile.read(buff, size);
-      ifile.close();
-      std::string ret(buff, size);
-      delete[] buff;
-      return ret;
-    });
-    futures.push_back(std::move(content_futures));
+  for (auto &segment : GenBodySegments()) {
+    if (!segment.is_file) {
+      body_content_ += segment.data;
+      continue;
+    }
+    std::ifstream ifile(segment.data, std::ios::binary);
+    body_content_.append(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
   }
+  return body_content_;
+}
+
+std::vector<MultipartParser::BodySegment> MultipartParser::GenBodySegments() {
+  std::vector<BodySegment> segments;
+  std::string literal;
 
   for (auto &param : params_) {
-    body_content_ += "\r\n--";
-    body_content_ += boundary_;
-    body_content_ += "\r\nContent-Disposition: form-data; name=\"";
-    body_content_ += param.first;
-    body_content_ += "\"\r\n\r\n";
-    body_content_ += param.second;
+    literal += "\r\n--";
+    literal += boundary_;
+    literal += "\r\nContent-Disposition: form-data; name=\"";
+    literal += param.first;
+    literal += "\"\r\n\r\n";
+    literal += param.second;
   }
 
-  for (size_t i = 0; i < files_.size(); ++i) {
+  for (auto &file : files_) {
     std::string filename;
     std::string content_type;
-    std::string file_content = futures[i].get();
-    _get_file_name_type(files_[i].second, &filename, &content_type);
-    body_content_ += "\r\n--";
-    body_content_ += boundary_;
-    body_content_ += "\r\nContent-Disposition: form-data; name=\"";
-    body_content_ += files_[i].first;
-    body_content_ += "\"; filename=\"";
-    body_content_ += filename;
-    body_content_ += "\"\r\nContent-Type: ";
-    body_content_ += content_type;
-    body_content_ += "\r\n\r\n";
-    body_content_ += file_content;
+    _get_file_name_type(file.second, &filename, &content_type);
+    literal += "\r\n--";
+    literal += boundary_;
+    literal += "\r\nContent-Disposition: form-data; name=\"";
+    literal += file.first;
+    literal += "\"; filename=\"";
+    literal += filename;
+    literal += "\"\r\nContent-Type: ";
+    literal += content_type;
+    literal += "\r\n\r\n";
+    segments.push_back(BodySegment{literal, false});
+    segments.push_back(BodySegment{file.second, true});
+    literal.clear();
   }
-  body_content_ += "\r\n--";
-  body_content_ += boundary_;
-  body_content_ += "--\r\n";
-  return body_content_;
+  literal += "\r\n--";
+  literal += boundary_;
+  literal += "--\r\n";
+  segments.push_back(BodySegment{literal, false});
+  return segments;
 }
 
 void MultipartParser::_get_file_name_type(const std::string &file_path, std::string *filename,
@@ -98,6 +99,14 @@ void MultipartParser::_get_file_name_type(const std::string &file_path, std::str
     *content_type = "image/jpeg";
     return;
   }
+  if (ext == "png") {
+    *content_type = "image/png";
+    return;
+  }
+  if (ext == "webp") {
+    *content_type = "image/webp";
+    return;
+  }
   if (ext == "txt" || ext == "log") {
     *content_type = "text/plain";
     return;
@@ -26,6 +26,16 @@ class MultipartParser {
   }
   const std::string &GenBodyContent();
 
+  // BodySegment is one contiguous piece of the generated body. Literal segments carry their bytes
+  // in data; file segments carry the path of the file whose contents belong at that position.
+  struct BodySegment {
+    std::string data;
+    bool is_file;
+  };
+  // GenBodySegments describes the body without reading any file contents, so that the body can be
+  // streamed from disk rather than held in memory (see GenBodyContent for the in-memory version)
+  std::vector<BodySegment> GenBodySegments();
+
  private:
   void _get_file_name_type(const std::string &file_path, std::string *filenae,
                            std::string *content_type);
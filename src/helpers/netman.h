@@ -7,6 +7,8 @@
 #include <QMessageAuthenticationCode>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QSslConfiguration>
+#include <QUrl>
 #include <algorithm>
 #include <iostream>
 #include <string>
@@ -17,9 +19,13 @@
 #include "dtos/operation.h"
 #include "dtos/tag.h"
 #include "dtos/github_release.h"
+#include "exceptions/fileerror.h"
 #include "helpers/file_helpers.h"
+#include "helpers/multipartbodydevice.h"
 #include "helpers/multipartparser.h"
+#include "helpers/requesttiming.h"
 #include "helpers/stopreply.h"
+#include "helpers/throttleddevice.h"
 #include "models/evidence.h"
 
 
@@ -43,6 +49,9 @@ class NetMan : public QObject {
 
  private:
   QNetworkAccessManager *nam;
+  /// uploadBucket is shared by all evidence uploads, so that (together) they stay within
+  /// AppConfig::uploadRateLimit
+  TokenBucket uploadBucket;
 
   NetMan() { nam = new QNetworkAccessManager; }
   ~NetMan() {
@@ -51,6 +60,16 @@ class NetMan : public QObject {
     stopReply(&githubReleaseReply);
   }
 
+  /// send executes the given request, and (if enabled via AppConfig::logRequestTiming) logs how
+  /// long each phase of the request took
+  QNetworkReply *send(RequestBuilder *builder) {
+    auto reply = builder->execute(nam);
+    if (AppConfig::getInstance().logRequestTiming) {
+      RequestTiming::track(reply);
+    }
+    return reply;
+  }
+
   /// ashirtGet generates a basic GET request to the ashirt API server. No authentication is
   /// provided (use addASHIRTAuth to do this)
   /// Allows for an optional altHost parameter, in order to check for ashirt servers.
@@ -71,20 +90,34 @@ class NetMan : public QObject {
         ->setBody(body);
   }
 
-  /// ashirtFormPost generates a basic POST request with content type multipart/form-data.
-  /// No authentication is provided (use addASHIRTAuth to do this)
-  RequestBuilder* ashirtFormPost(QString endpoint, QByteArray body, QString boundry) {
+  /// ashirtFormPost generates a basic POST request with content type multipart/form-data. The body
+  /// is streamed from the provided (open) device. No authentication is provided (use addASHIRTAuth
+  /// to do this)
+  RequestBuilder* ashirtFormPost(QString endpoint, QIODevice* body, QString boundry) {
     return RequestBuilder::newFormPost(boundry)
         ->setHost(AppConfig::getInstance().apiURL)
         ->setEndpoint(endpoint)
-        ->setBody(body);
+        ->setBodyDevice(body);
   }
 
   /// addASHIRTAuth takes the provided RequestBuilder and adds on Authorization and Date headers
   /// in order to properly authenticate with ASHIRT servers. Note that this should not be used for
   /// non-ashirt requests
+  /// @throws a FileError if the request's body device cannot be read
   void addASHIRTAuth(RequestBuilder* reqBuilder, const QString& altApiKey = "",
                      const QString& altSecretKey = "") {
+    // streamed bodies are hashed chunk-by-chunk, so they never need to be held in memory
+    auto bodyDevice = reqBuilder->getBodyDevice();
+    auto hashedBody = (bodyDevice == nullptr) ? hashBody(reqBuilder->getBody())
+                                              : hashBody(bodyDevice);
+    addASHIRTAuthWithBodyHash(reqBuilder, hashedBody, altApiKey, altSecretKey);
+  }
+
+  /// addASHIRTAuthWithBodyHash is addASHIRTAuth, for a request whose body has already been hashed
+  /// (see hashBody). Streamed bodies are hashed this way, ahead of time and off the UI thread (see
+  /// prepareUpload), as hashing them means reading them in full.
+  void addASHIRTAuthWithBodyHash(RequestBuilder* reqBuilder, const QByteArray& hashedBody,
+                                 const QString& altApiKey = "", const QString& altSecretKey = "") {
     auto now = QDateTime::currentDateTimeUtc().toString("ddd, dd MMM yyyy hh:mm:ss 'GMT'");
     reqBuilder->addRawHeader("Date", now);
 
@@ -94,18 +127,42 @@ class NetMan : public QObject {
       apiKeyCopy = AppConfig::getInstance().accessKey;
     }
 
-    auto code = generateHash(RequestMethodToString(reqBuilder->getMethod()),
-                             reqBuilder->getEndpoint(), now, reqBuilder->getBody(), altSecretKey);
+    auto code = generateHashFromBodyHash(RequestMethodToString(reqBuilder->getMethod()),
+                                         reqBuilder->getEndpoint(), now, hashedBody, altSecretKey);
 
     auto authValue = apiKeyCopy + ":" + code;
     reqBuilder->addRawHeader("Authorization", authValue);
   }
 
+  /// hashBody provides the SHA-256 digest of an in-memory request body
+  static QByteArray hashBody(const QByteArray &body) {
+    return QCryptographicHash::hash(body, QCryptographicHash::Sha256);
+  }
+
+  /// hashBody provides the SHA-256 digest of a streamed request body. The device is read in chunks
+  /// from its current position to the end, and then rewound so that it can be sent.
+  /// @throws a FileError if the body cannot be read (a partial digest would fail authentication)
+  static QByteArray hashBody(QIODevice *body) {
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    if (!hasher.addData(body)) {
+      throw FileError::mkError("Unable to read request body for signing (" +
+                                   body->errorString().toStdString() + ")",
+                               "", QFileDevice::ReadError);
+    }
+    body->reset();
+    return hasher.result();
+  }
 
   /// generateHash provides a cryptographic hash for ASHIRT api server communication
   QString generateHash(QString method, QString path, QString date, QByteArray body = NO_BODY,
                        const QString &secretKey = "") {
-    auto hashedBody = QCryptographicHash::hash(body, QCryptographicHash::Sha256);
+    return generateHashFromBodyHash(method, path, date, hashBody(body), secretKey);
+  }
+
+  /// generateHashFromBodyHash provides a cryptographic hash for ASHIRT api server communication,
+  /// given an already-computed SHA-256 digest of the request body (see hashBody)
+  QString generateHashFromBodyHash(QString method, QString path, QString date,
+                                   const QByteArray &hashedBody, const QString &secretKey = "") {
     std::string msg = (method + "\n" + path + "\n" + date + "\n").toStdString();
     msg += hashedBody.toStdString();
 
@@ -157,14 +214,27 @@ class NetMan : public QObject {
 
  public:
 
-  /// uploadAsset takes the given Evidence model, encodes it (and the file), and uploads this
-  /// to the configured ASHIRT API server. Returns a QNetworkReply to track the request
+  /// PreparedUpload is an evidence upload whose body has been laid out and hashed (see
+  /// prepareUpload), and so can be signed and sent right away (see uploadAsset)
+  struct PreparedUpload {
+    model::Evidence evidence;
+    MultipartParser parser;
+    QByteArray hashedBody;
+    /// errorText is set if the evidence file could not be read (in which case there is no hash)
+    QString errorText;
+  };
+
+  /// prepareUpload encodes the given Evidence model (and the file) as an upload body, and hashes
+  /// that body so that the request can be signed. The body is read in chunks, so it is never held
+  /// in memory, but the whole file is still read: run this off the UI thread (e.g. via
+  /// QtConcurrent::run). Safe to call from any thread.
   /// Note: does not specify the occurred_at field, so occurred_at will reflect the time of upload,
   /// rather than the time of capture.
-  QNetworkReply *uploadAsset(model::Evidence evidence) {
-    MultipartParser parser;
-    parser.AddParameter("notes", evidence.description.toStdString());
-    parser.AddParameter("contentType", evidence.contentType.toStdString());
+  static PreparedUpload prepareUpload(model::Evidence evidence) {
+    PreparedUpload upload;
+    upload.evidence = evidence;
+    upload.parser.AddParameter("notes", evidence.description.toStdString());
+    upload.parser.AddParameter("contentType", evidence.contentType.toStdString());
 
     // TODO: convert this time below into a proper unix timestamp (mSecSinceEpoch and secsSinceEpoch
     // produce invalid times)
@@ -174,15 +244,75 @@ class NetMan : public QObject {
     for (auto tag : evidence.tags) {
       list << QString::number(tag.serverTagId);
     }
-    parser.AddParameter("tagIds", ("[" + list.join(",") + "]").toStdString());
+    upload.parser.AddParameter("tagIds", ("[" + list.join(",") + "]").toStdString());
+
+    upload.parser.AddFile("file", evidence.path.toStdString());
+
+    MultipartBodyDevice body(upload.parser);
+    if (!body.open(QIODevice::ReadOnly)) {
+      upload.errorText = FileError::mkError("Unable to read evidence file",
+                                            evidence.path.toStdString(), QFileDevice::OpenError)
+                             .what();
+      return upload;
+    }
+    try {
+      upload.hashedBody = hashBody(&body);
+    }
+    catch (FileError &) {
+      upload.errorText = FileError::mkError("Unable to read evidence file",
+                                            evidence.path.toStdString(), QFileDevice::ReadError)
+                             .what();
+    }
+    return upload;
+  }
 
-    parser.AddFile("file", evidence.path.toStdString());
+  /// uploadAsset uploads the given (prepared, see prepareUpload) evidence to the configured ASHIRT
+  /// API server. Returns a QNetworkReply to track the request.
+  /// The file is streamed from disk as the request is sent, rather than loaded into memory.
+  /// @throws a FileError if the evidence file can no longer be opened
+  QNetworkReply *uploadAsset(const PreparedUpload &upload) {
+    MultipartParser parser = upload.parser;
+    auto body = new MultipartBodyDevice(parser);
+    if (!body->open(QIODevice::ReadOnly)) {
+      delete body;
+      throw FileError::mkError("Unable to read evidence file", upload.evidence.path.toStdString(),
+                               QFileDevice::OpenError);
+    }
 
-    auto body = FileHelpers::stdStringToByteArray(parser.GenBodyContent());
+    auto builder = ashirtFormPost("/api/operations/" + upload.evidence.operationSlug + "/evidence",
+                                  body, parser.boundary().c_str());
+    addASHIRTAuthWithBodyHash(builder, upload.hashedBody);
+
+    // throttled after signing, so that hashing the body is not rate limited
+    uploadBucket.setRate(qint64(AppConfig::getInstance().uploadRateLimit) * 1024);
+    if (uploadBucket.rate() > 0) {
+      auto throttled = new ThrottledDevice(body, &uploadBucket);
+      body->setParent(throttled);
+      throttled->open(QIODevice::ReadOnly);
+      builder->setBodyDevice(throttled);
+    }
+    return send(builder);
+  }
 
-    auto builder = ashirtFormPost("/api/operations/" + evidence.operationSlug + "/evidence", body, parser.boundary().c_str());
-    addASHIRTAuth(builder);
-    return builder->execute(nam);
+  /// prewarmConnection opens (or refreshes) a connection to the configured ASHIRT API server ahead
+  /// of time, so that the next request does not have to wait on DNS, TCP and TLS setup. Intended
+  /// to be called when the user starts a capture, so the handshake overlaps with them describing
+  /// the evidence.
+  void prewarmConnection() {
+    QUrl url(AppConfig::getInstance().apiURL);
+    if (!url.isValid() || url.host().isEmpty()) {
+      return;
+    }
+    if (url.scheme() == "https") {
+      // offer the same protocols as regular requests, so that the connection can be reused by them
+      auto sslConfig = QSslConfiguration::defaultConfiguration();
+      sslConfig.setAllowedNextProtocols(
+          {QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+      nam->connectToHostEncrypted(url.host(), quint16(url.port(443)), sslConfig);
+    }
+    else {
+      nam->connectToHost(url.host(), quint16(url.port(80)));
+    }
   }
 
   /// testConnection provides a mechanism to validate a given host, apikey and secret key, to test
@@ -190,7 +320,7 @@ class NetMan : public QObject {
   QNetworkReply *testConnection(QString host, QString apiKey, QString secretKey) {
     auto builder = ashirtGet("/api/checkconnection", host);
     addASHIRTAuth(builder, apiKey, secretKey);
-    return builder->execute(nam);
+    return send(builder);
   }
 
   /// getAllOperations retrieves all (user-visble) operations from the configured ASHIRT API server.
@@ -199,16 +329,15 @@ class NetMan : public QObject {
   QNetworkReply *getAllOperations() {
     auto builder = ashirtGet("/api/operations");
     addASHIRTAuth(builder);
-    return builder->execute(nam);
+    return send(builder);
   }
 
   /// getGithubReleases retrieves the recent releases from github for the provided owner and repo.
   /// Note that normally you should call checkForNewRelease
   QNetworkReply *getGithubReleases(QString owner, QString repo) {
-    return RequestBuilder::newGet()
-        ->setHost("https://api.github.com")
-        ->setEndpoint("/repos/" + owner + "/" + repo + "/releases")
-        ->execute(nam);
+    return send(RequestBuilder::newGet()
+                    ->setHost("https://api.github.com")
+                    ->setEndpoint("/repos/" + owner + "/" + repo + "/releases"));
   }
 
   /// refreshOperationsList retrieves the operations currently visible to the user. Results should be
@@ -224,21 +353,21 @@ class NetMan : public QObject {
   QNetworkReply *getOperationTags(QString operationSlug) {
     auto builder = ashirtGet("/api/operations/" + operationSlug + "/tags");
     addASHIRTAuth(builder);
-    return builder->execute(nam);
+    return send(builder);
   }
 
   /// createTag attempts to create a new tag for specified operation from the ASHIRT API server.
   QNetworkReply *createTag(dto::Tag tag, QString operationSlug) {
     auto builder = ashirtJSONPost("/api/operations/" + operationSlug + "/tags", dto::Tag::toJson(tag));
     addASHIRTAuth(builder);
-    return builder->execute(nam);
+    return send(builder);
   }
 
   /// createOperation attempts to create a new operation with the given name and slug
   QNetworkReply *createOperation(QString name, QString slug) {
     auto builder = ashirtJSONPost("/api/operations", dto::Operation::createOperationJson(name, slug));
     addASHIRTAuth(builder);
-    return builder->execute(nam);
+    return send(builder);
   }
 
   /// extractResponse inspects the provided QNetworkReply and returns back the contents of the reply.
@@ -0,0 +1,111 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef PERCEPTUALHASH_H
+#define PERCEPTUALHASH_H
+
+#include <QImage>
+#include <QString>
+#include <array>
+#include <bitset>
+
+/**
+ * @brief The PerceptualHash class computes difference hashes (dHash) of images. Unlike a content
+ * hash, images that look alike (e.g. the same terminal, with a different clock or cursor position)
+ * get hashes that differ in only a few bits, so the number of differing bits (see distance)
+ * measures how similar two images are.
+ *
+ * The hash compares neighboring pixels of a 33x32 grayscale reduction, for 1024 bits. Captures are
+ * mostly text on a plain background, and a smaller reduction (e.g. the common 9x8) blurs any two
+ * such screens into nearly the same hash. See bench/phashbench for how the size and
+ * maxSimilarDistance were chosen.
+ */
+class PerceptualHash {
+ public:
+  /// hashColumns and hashRows give the number of comparisons made across, and down, the image
+  static const int hashColumns = 32;
+  static const int hashRows = 32;
+  /// hashWords is the number of 64 bit words in a hash
+  static const int hashWords = hashColumns * hashRows / 64;
+  /// maxSimilarDistance is the largest distance at which two images are considered similar
+  static const int maxSimilarDistance = 48;
+
+  /// Bits holds a decoded hash
+  using Bits = std::array<quint64, hashWords>;
+
+  /// dHash computes the (hex-encoded, 1024 bit) difference hash of the given image. Returns an
+  /// empty string for a null image. Safe to call from a worker thread.
+  static QString dHash(const QImage &image) {
+    if (image.isNull()) {
+      return "";
+    }
+    // one more column than comparisons, so that each row yields hashColumns left-to-right
+    // comparisons
+    QImage small =
+        image.scaled(hashColumns + 1, hashRows, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+            .convertToFormat(QImage::Format_Grayscale8);
+
+    QString hex;
+    hex.reserve(hashWords * 16);
+    const int rowsPerWord = 64 / hashColumns;
+    for (int word = 0; word < hashWords; word++) {
+      quint64 bits = 0;
+      for (int r = 0; r < rowsPerWord; r++) {
+        const uchar *row = small.constScanLine(word * rowsPerWord + r);
+        // compare first, then pack, so that the comparisons are free of branches and dependencies
+        // (and so can be vectorized)
+        uchar brighter[hashColumns];
+        for (int x = 0; x < hashColumns; x++) {
+          brighter[x] = uchar(row[x] < row[x + 1]);
+        }
+        for (int x = 0; x < hashColumns; x++) {
+          bits |= quint64(brighter[x]) << (r * hashColumns + x);
+        }
+      }
+      hex += QString("%1").arg(bits, 16, 16, QChar('0'));
+    }
+    return hex;
+  }
+
+  /// dHashFile computes the difference hash of the image at the given path. Returns an empty
+  /// string if the file cannot be read as an image. Safe to call from a worker thread.
+  static QString dHashFile(const QString &path) { return dHash(QImage(path)); }
+
+  /// decode parses the given (hex-encoded) hash into bits. Returns false if it is not a valid hash
+  /// (e.g. empty, or from an older, smaller hash).
+  static bool decode(const QString &hash, Bits &bits) {
+    if (hash.length() != hashWords * 16) {
+      return false;
+    }
+    for (int word = 0; word < hashWords; word++) {
+      bool ok = false;
+      bits[size_t(word)] = hash.midRef(word * 16, 16).toULongLong(&ok, 16);
+      if (!ok) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// distance returns the number of bits that differ between the given (decoded) hashes
+  static int distance(const Bits &a, const Bits &b) {
+    int count = 0;
+    for (size_t word = 0; word < a.size(); word++) {
+      count += int(std::bitset<64>(a[word] ^ b[word]).count());
+    }
+    return count;
+  }
+
+  /// distance returns the number of bits that differ between the given hashes, or -1 if either is
+  /// not a valid hash
+  static int distance(const QString &a, const QString &b) {
+    Bits bitsA;
+    Bits bitsB;
+    if (!decode(a, bitsA) || !decode(b, bitsB)) {
+      return -1;
+    }
+    return distance(bitsA, bitsB);
+  }
+};
+
+#endif  // PERCEPTUALHASH_H
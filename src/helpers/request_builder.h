@@ -44,6 +44,7 @@ class RequestBuilder {
  private:
   RequestMethod method;
   QByteArray body = NO_BODY;
+  QIODevice* bodyDevice = nullptr;
   QString host;
   QString endpoint;
 
@@ -91,6 +92,11 @@ class RequestBuilder {
     return this->body;
   }
 
+  /// getBodyDevice retrieves the set body device (or nullptr, if the body is held in memory)
+  QIODevice* getBodyDevice() {
+    return this->bodyDevice;
+  }
+
   /// getEndpoint retrieves the set endpoint
   QString getEndpoint() {
     return this->endpoint;
@@ -124,6 +130,14 @@ class RequestBuilder {
     return this;
   }
 
+  /// setBodyDevice sets a device to stream the body from, rather than an in-memory body. This is
+  /// intended for large bodies (e.g. file uploads). The device must already be open and report its
+  /// size. Ownership of the device passes to the QNetworkReply returned from execute.
+  RequestBuilder* setBodyDevice(QIODevice* device) {
+    this->bodyDevice = device;
+    return this;
+  }
+
   /// setHost sets the host for this request
   RequestBuilder* setHost(QString host) {
     this->host = host;
@@ -163,6 +177,8 @@ class RequestBuilder {
     }
     url += endpoint;
     req.setUrl(url);
+    // negotiated via ALPN; falls back to HTTP/1.1 (over a kept-alive connection) when unsupported
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
 
     return req;
   }
@@ -183,7 +199,14 @@ class RequestBuilder {
         reply = nam->get(req);
         break;
       case METHOD_POST:
-        reply = nam->post(req, body);
+        if (bodyDevice != nullptr) {
+          req.setHeader(QNetworkRequest::ContentLengthHeader, bodyDevice->size());
+          reply = nam->post(req, bodyDevice);
+          bodyDevice->setParent(reply);  // clean up the device along with the reply
+        }
+        else {
+          reply = nam->post(req, body);
+        }
         break;
       default:
         std::cerr << "Requestbuilder contains an unsupported request method" << std::endl;
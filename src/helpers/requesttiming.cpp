@@ -0,0 +1,44 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "requesttiming.h"
+
+#include <iostream>
+
+void RequestTiming::track(QNetworkReply* reply) {
+  if (reply != nullptr) {
+    new RequestTiming(reply);
+  }
+}
+
+RequestTiming::RequestTiming(QNetworkReply* reply) : QObject(reply) {
+  this->reply = reply;
+  clock.start();
+  connect(reply, &QNetworkReply::encrypted, this, &RequestTiming::onEncrypted);
+  connect(reply, &QNetworkReply::metaDataChanged, this, &RequestTiming::onMetaDataChanged);
+  connect(reply, &QNetworkReply::finished, this, &RequestTiming::onFinished);
+}
+
+void RequestTiming::onEncrypted() { connectedAt = clock.elapsed(); }
+
+void RequestTiming::onMetaDataChanged() {
+  if (firstByteAt == -1) {
+    firstByteAt = clock.elapsed();
+  }
+}
+
+void RequestTiming::onFinished() {
+  auto ms = [](qint64 val) {
+    return (val == -1) ? std::string("n/a") : std::to_string(val) + "ms";
+  };
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  bool http2 = reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+
+  bool isPost = reply->operation() == QNetworkAccessManager::PostOperation;
+
+  std::cout << "Request timing: " << (isPost ? "POST " : "GET ")
+            << reply->url().toString().toStdString() << " status=" << status
+            << " http2=" << (http2 ? "yes" : "no")
+            << " connect=" << (connectedAt == -1 ? std::string("reused") : ms(connectedAt))
+            << " ttfb=" << ms(firstByteAt) << " total=" << ms(clock.elapsed()) << std::endl;
+}
@@ -0,0 +1,40 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef REQUESTTIMING_H
+#define REQUESTTIMING_H
+
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QObject>
+
+/**
+ * @brief The RequestTiming class measures the phases of a single network request, and logs them
+ * (to stdout) once the request finishes. This is intended for diagnosing slow requests.
+ *
+ * Qt does not report DNS lookup or TCP connect times separately, so the "connect" phase covers
+ * DNS + TCP + TLS together. It is only reported when a new (encrypted) connection was made; a
+ * request that reused a kept-alive connection reports "reused" instead.
+ */
+class RequestTiming : public QObject {
+  Q_OBJECT
+
+ public:
+  /// track starts timing the given (just sent) reply. The timer is owned by the reply.
+  static void track(QNetworkReply* reply);
+
+ private:
+  explicit RequestTiming(QNetworkReply* reply);
+
+  void onEncrypted();
+  void onMetaDataChanged();
+  void onFinished();
+
+ private:
+  QNetworkReply* reply;
+  QElapsedTimer clock;
+  qint64 connectedAt = -1;
+  qint64 firstByteAt = -1;
+};
+
+#endif  // REQUESTTIMING_H
@@ -3,9 +3,14 @@
 
 #include "screenshot.h"
 
+#include <QCursor>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QImageWriter>
 #include <QObject>
+#include <QtConcurrent>
 
 #include <array>
 #include <cstdio>
@@ -13,10 +18,53 @@
 #include <string>
 #include <utility>
 
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 #include "appconfig.h"
 #include "helpers/file_helpers.h"
 
-Screenshot::Screenshot(QObject *parent) : QObject(parent) {}
+// syncToDisk flushes the given file to disk, so that the capture is durable before anything refers
+// to it
+static void syncToDisk(const QString &path) {
+  QFile saved(path);
+#ifdef Q_OS_WIN
+  if (saved.open(QIODevice::ReadWrite)) {
+    _commit(saved.handle());
+  }
+#else
+  if (saved.open(QIODevice::ReadOnly)) {
+    fsync(saved.handle());
+  }
+#endif
+}
+
+QScreen *Screenshot::screenUnderCursor() {
+  auto screen = QGuiApplication::screenAt(QCursor::pos());
+  return screen != nullptr ? screen : QGuiApplication::primaryScreen();
+}
+
+Screenshot::Screenshot(QObject *parent) : QObject(parent) {
+  captureProcess = new QProcess(this);
+  captureTimer = new QTimer(this);
+  captureTimer->setSingleShot(true);
+
+  connect(captureProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          &Screenshot::onCaptureFinished);
+  connect(captureProcess, &QProcess::errorOccurred, this, &Screenshot::onCaptureError);
+  connect(captureTimer, &QTimer::timeout, this, &Screenshot::onCaptureTimeout);
+}
+
+Screenshot::~Screenshot() {
+  // don't leave a capture tool running (e.g. waiting on a selection) after we close
+  if (captureProcess->state() != QProcess::NotRunning) {
+    captureProcess->kill();
+    captureProcess->waitForFinished(1000);
+  }
+}
 
 QString Screenshot::formatScreenshotCmd(QString cmdProto, const QString &filename) {
   auto lowerCmd = cmdProto.toLower();
@@ -29,30 +77,223 @@ QString Screenshot::formatScreenshotCmd(QString cmdProto, const QString &filenam
   return cmdProto.replace(idx, key.length(), fixedFilename);
 }
 
-void Screenshot::captureArea() { basicScreenshot(AppConfig::getInstance().screenshotExec); }
+void Screenshot::captureArea() {
+  auto &conf = AppConfig::getInstance();
+  if (conf.builtInCapture || conf.screenshotExec.isEmpty()) {
+    builtInCaptureArea(conf.screenshotExec);
+  }
+  else {
+    basicScreenshot(conf.screenshotExec);
+  }
+}
+
+void Screenshot::captureWindow() {
+  // Qt cannot grab another application's window, so the built-in backend is only used when no
+  // command is configured, and then captures the whole screen
+  auto &conf = AppConfig::getInstance();
+  if (conf.captureWindowExec.isEmpty()) {
+    builtInCaptureScreen();
+  }
+  else {
+    basicScreenshot(conf.captureWindowExec);
+  }
+}
+
+bool Screenshot::captureInProgress() {
+  if (captureProcess->state() != QProcess::NotRunning || !overlay.isNull()) {
+    std::cout << "A capture is already in progress; ignoring new capture request" << std::endl;
+    return true;
+  }
+  return false;
+}
+
+void Screenshot::builtInCaptureArea(const QString &fallbackCmd) {
+  if (captureInProgress()) {
+    return;
+  }
+  overlay = new CaptureOverlay(screenUnderCursor());
+  if (!overlay->hasScreenshot()) {
+    // e.g. a platform that does not allow grabbing the screen
+    delete overlay;
+    if (fallbackCmd.isEmpty()) {
+      emit onScreenshotFailed("Unable to capture the screen");
+    }
+    else {
+      basicScreenshot(fallbackCmd);
+    }
+    return;
+  }
+  connect(overlay, &CaptureOverlay::areaSelected, this, &Screenshot::saveCapture);
+  overlay->start();
+}
+
+void Screenshot::builtInCaptureScreen() {
+  if (captureInProgress()) {
+    return;
+  }
+  auto pixmap = screenUnderCursor()->grabWindow(0);
+  if (pixmap.isNull()) {
+    emit onScreenshotFailed("Unable to capture the screen");
+    return;
+  }
+  saveCapture(pixmap.toImage());
+}
 
-void Screenshot::captureWindow() { basicScreenshot(AppConfig::getInstance().captureWindowExec); }
+void Screenshot::saveCapture(QImage image) {
+  // written straight into the evidence directory; encoding runs on a worker, off the UI thread
+  auto watcher = new QFutureWatcher<QString>(this);
+  connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher]() {
+    auto savedPath = watcher->result();
+    watcher->deleteLater();
+    if (savedPath.isEmpty()) {
+      emit onScreenshotFailed("Unable to save capture to the evidence directory");
+      return;
+    }
+    emit onScreenshotCaptured(savedPath);
+  });
+  watcher->setFuture(QtConcurrent::run(&Screenshot::writeToEvidence, image,
+                                       CaptureEncoding::fromConfig(),
+                                       FileHelpers::pathToEvidence()));
+}
 
 void Screenshot::basicScreenshot(QString cmdProto) {
-  auto root = FileHelpers::pathToEvidence();
-  auto hasPath = QDir().mkpath(root);
+  if (captureInProgress()) {
+    return;
+  }
+
+  tempPath = FileHelpers::randomFilename(QDir::tempPath() + "/ashirt_screenshot_XXXXXX.png");
+  captureDevicePixelRatio = screenUnderCursor()->devicePixelRatio();
+  QString cmd = formatScreenshotCmd(std::move(cmdProto), tempPath);
 
-  if (hasPath) {
-    auto tempPath = FileHelpers::randomFilename(QDir::tempPath() + "/ashirt_screenshot_XXXXXX.png");
+  // run through the shell, as system() did, so that configured commands keep working as written
+#ifdef Q_OS_WIN
+  captureProcess->start("cmd.exe", QStringList() << "/c" << cmd);
+#else
+  captureProcess->start("/bin/sh", QStringList() << "-c" << cmd);
+#endif
+  captureTimer->start(AppConfig::getInstance().captureTimeoutSecs * 1000);
+}
 
-    QString cmd = formatScreenshotCmd(std::move(cmdProto), tempPath);
-    auto lastSlash = tempPath.lastIndexOf("/") + 1;
-    QString tempName = tempPath.right(tempPath.length() - lastSlash);
+void Screenshot::onCaptureFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+  captureTimer->stop();
+  if (tempPath.isEmpty()) {
+    return;  // abandoned (see onCaptureTimeout)
+  }
+  QString capturePath = tempPath;
+  tempPath.clear();
+
+  QFileInfo capture(capturePath);
+  if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+    QFile::remove(capturePath);
+    QString detail = QString::fromLocal8Bit(captureProcess->readAllStandardError()).trimmed();
+    QString reason = (exitStatus != QProcess::NormalExit)
+                         ? QString("Capture command crashed")
+                         : QString("Capture command failed (exit code %1)").arg(exitCode);
+    emit onScreenshotFailed(detail.isEmpty() ? reason : reason + ": " + detail);
+    return;
+  }
+  // the user may have cancelled the capture, in which case there is no file
+  if (!capture.exists()) {
+    return;
+  }
+  if (capture.size() == 0) {
+    QFile::remove(capturePath);
+    emit onScreenshotFailed("Capture command did not write an image");
+    return;
+  }
+  auto watcher = new QFutureWatcher<QString>(this);
+  connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher]() {
+    auto finalPath = watcher->result();
+    watcher->deleteLater();
+    emit onScreenshotCaptured(finalPath);
+  });
+  // the evidence directory depends on the current operation, so resolve it here, not on the worker
+  watcher->setFuture(QtConcurrent::run(&Screenshot::storeCapture, capturePath,
+                                       captureDevicePixelRatio, CaptureEncoding::fromConfig(),
+                                       FileHelpers::pathToEvidence()));
+}
+
+void Screenshot::onCaptureError(QProcess::ProcessError error) {
+  // other errors (e.g. crashes) are followed by finished, and handled there
+  if (error == QProcess::FailedToStart) {
+    captureTimer->stop();
+    tempPath.clear();
+    emit onScreenshotFailed("Unable to run capture command: " + captureProcess->errorString());
+  }
+}
 
-    system(cmd.toStdString().c_str());
+void Screenshot::onCaptureTimeout() {
+  QString capturePath = tempPath;
+  tempPath.clear();
+  captureProcess->kill();
+  QFile::remove(capturePath);
+  emit onScreenshotFailed(QString("Capture command did not finish within %1 seconds")
+                              .arg(AppConfig::getInstance().captureTimeoutSecs));
+}
 
-    // check if file exists before doing this
-    auto finalName = root + tempName;
-    QFile src(tempPath);
-    if (src.exists()) {
-      auto moved = src.rename(QString(finalName));
-      auto trueName = moved ? finalName : tempName;
-      emit onScreenshotCaptured(trueName);
+QString Screenshot::storeCapture(const QString &tempPath, qreal devicePixelRatio,
+                                const CaptureEncoding &encoding, const QString &evidenceDir) {
+  if (!encoding.isPassthrough()) {
+    QImage image(tempPath);
+    if (!image.isNull()) {
+      image.setDevicePixelRatio(devicePixelRatio);
+      auto path = writeToEvidence(image, encoding, evidenceDir);
+      if (!path.isEmpty()) {
+        QFile::remove(tempPath);
+        return path;
+      }
     }
+    // otherwise, keep the capture as the tool wrote it
+  }
+
+  auto lastSlash = tempPath.lastIndexOf("/") + 1;
+  QString tempName = tempPath.right(tempPath.length() - lastSlash);
+
+  auto finalName = evidenceDir + tempName;
+  QFile src(tempPath);
+  auto trueName = src.rename(finalName) ? finalName : tempPath;
+
+  syncToDisk(trueName);
+  return trueName;
+}
+
+QString Screenshot::writeToEvidence(QImage image, const CaptureEncoding &encoding,
+                                    const QString &evidenceDir) {
+  if (encoding.downscale && image.devicePixelRatio() > 1) {
+    QSize logicalSize = image.size() / image.devicePixelRatio();
+    image = image.scaled(logicalSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
+  if (encoding.format == "jpg") {
+    image = image.convertToFormat(QImage::Format_RGB32);  // no alpha channel in JPEG
+  }
+
+  auto path = FileHelpers::randomFilename(evidenceDir + "ashirt_screenshot_XXXXXX." +
+                                          encoding.format);
+  QImageWriter writer(path, encoding.format.toLatin1());
+  writer.setQuality(encoding.quality);
+  if (!writer.write(image)) {
+    std::cout << "Unable to write capture to " << path.toStdString()
+              << ". Error: " << writer.errorString().toStdString() << std::endl;
+    QFile::remove(path);
+    return "";
+  }
+  syncToDisk(path);
+  return path;
+}
+
+CaptureEncoding CaptureEncoding::fromConfig() {
+  auto &conf = AppConfig::getInstance();
+  CaptureEncoding encoding;
+  encoding.format = conf.captureFormat.toLower();
+  if (encoding.format == "jpeg") {
+    encoding.format = "jpg";
+  }
+  if (!QImageWriter::supportedImageFormats().contains(encoding.format.toLatin1())) {
+    std::cout << "Capture format " << encoding.format.toStdString()
+              << " is not supported; saving as png" << std::endl;
+    encoding.format = "png";
   }
+  encoding.quality = conf.captureQuality;
+  encoding.downscale = conf.downscaleHiDPICaptures;
+  return encoding;
 }
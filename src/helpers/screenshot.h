@@ -4,22 +4,102 @@
 #ifndef SCREENSHOT_H
 #define SCREENSHOT_H
 
+#include <QImage>
 #include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QScreen>
+#include <QTimer>
 #include <string>
 
+#include "components/capture_overlay/captureoverlay.h"
+
+/// CaptureEncoding describes how captures are stored (see AppConfig::captureFormat, etc)
+struct CaptureEncoding {
+  /// format is the image format (and file extension) to store captures as: png, jpg or webp
+  QString format = "png";
+  /// quality is the encoder's quality setting (0-100, or -1 for the default). For png, lower
+  /// values compress harder (still losslessly); for webp, 100 is lossless.
+  int quality = -1;
+  /// downscale reduces HiDPI captures to their logical (1x) size
+  bool downscale = false;
+
+  /// isPassthrough returns true if captures can be stored exactly as the capture tool wrote them
+  bool isPassthrough() const { return format == "png" && quality < 0 && !downscale; }
+  /// fromConfig reads the current encoding settings. Falls back to png if the configured format
+  /// is not supported.
+  static CaptureEncoding fromConfig();
+};
+
+/**
+ * @brief The Screenshot class captures screenshots. By default, area captures use a built-in
+ * backend: the screen is grabbed in-process, the user selects an area on a CaptureOverlay, and the
+ * result is written straight into the evidence directory. The configured capture commands are
+ * used when the built-in backend is disabled (see AppConfig::builtInCapture) or unavailable, and
+ * for window captures.
+ *
+ * Commands run as a background process, so the rest of the application (hotkeys, uploads) keeps
+ * working while the user selects what to capture. Commands that run for longer than
+ * AppConfig::captureTimeoutSecs are killed. Once the command finishes, the capture is moved into
+ * the evidence directory (on a worker thread).
+ *
+ * Either way, captures are then re-encoded on a worker thread as configured (see CaptureEncoding),
+ * and onScreenshotCaptured is emitted once the file has been flushed to disk.
+ */
 class Screenshot : public QObject {
   Q_OBJECT
  public:
   Screenshot(QObject* parent = 0);
+  ~Screenshot();
   void captureArea();
   void captureWindow();
 
+  /// screenUnderCursor returns the screen the mouse is on, which is taken to be the one the user
+  /// wants to capture
+  static QScreen* screenUnderCursor();
+  /// writeToEvidence encodes the given image into a new file in evidenceDir, and flushes it to
+  /// disk. Returns the file's path, or an empty string if the image could not be written. Safe to
+  /// run on any thread.
+  static QString writeToEvidence(QImage image, const CaptureEncoding& encoding,
+                                 const QString& evidenceDir);
+
  signals:
   void onScreenshotCaptured(QString filepath);
+  /// onScreenshotFailed is emitted when a capture command could not be run, failed, timed out,
+  /// or wrote an empty file
+  void onScreenshotFailed(QString errorText);
 
  private:
   QString formatScreenshotCmd(QString cmdProto, const QString& filename);
+  /// captureInProgress returns true (and logs) if a capture is already underway
+  bool captureInProgress();
+  /// builtInCaptureArea lets the user select an area of the screen under the cursor. If the
+  /// screen cannot be grabbed, fallbackCmd (if any) is run instead.
+  void builtInCaptureArea(const QString& fallbackCmd);
+  /// builtInCaptureScreen captures the whole screen under the cursor
+  void builtInCaptureScreen();
+  /// saveCapture writes the given image into the evidence directory (in the background)
+  void saveCapture(QImage image);
   void basicScreenshot(QString cmdProto);
+  void onCaptureFinished(int exitCode, QProcess::ExitStatus exitStatus);
+  void onCaptureError(QProcess::ProcessError error);
+  void onCaptureTimeout();
+
+  /// storeCapture moves the given (external tool) capture into evidenceDir (which must end with a
+  /// path separator), re-encoding it if needed, and flushes it to disk. devicePixelRatio is the
+  /// ratio of the captured screen. Returns the capture's final path. Safe to run on any thread.
+  static QString storeCapture(const QString& tempPath, qreal devicePixelRatio,
+                              const CaptureEncoding& encoding, const QString& evidenceDir);
+
+ private:
+  QProcess* captureProcess = nullptr;
+  QTimer* captureTimer = nullptr;
+  /// overlay is the area selection overlay, while one is shown (it deletes itself when closed)
+  QPointer<CaptureOverlay> overlay;
+  /// tempPath is where the running capture command was asked to write its file
+  QString tempPath;
+  /// captureDevicePixelRatio is the ratio of the screen the running capture command is capturing
+  qreal captureDevicePixelRatio = 1;
 };
 
 #endif  // SCREENSHOT_H
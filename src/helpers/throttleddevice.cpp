@@ -0,0 +1,101 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "throttleddevice.h"
+
+#include <QTimer>
+#include <algorithm>
+
+// minimumRead is the smallest read (in bytes) worth waking up for, so that a slow rate is served
+// in reasonably sized pieces rather than a byte at a time
+static const qint64 minimumRead = 4 * 1024;
+
+void TokenBucket::setRate(qint64 bytesPerSecond) {
+  if (this->bytesPerSecond == bytesPerSecond) {
+    return;
+  }
+  this->bytesPerSecond = std::max(qint64(0), bytesPerSecond);
+  tokens = 0;
+  clock.start();
+}
+
+qint64 TokenBucket::capacity() {
+  // allow a burst of up to a quarter second's worth of data
+  return std::max(minimumRead, bytesPerSecond / 4);
+}
+
+void TokenBucket::refill() {
+  if (!clock.isValid()) {
+    clock.start();
+  }
+  tokens = std::min(double(capacity()), tokens + clock.restart() * bytesPerSecond / 1000.0);
+}
+
+qint64 TokenBucket::take(qint64 wanted) {
+  if (bytesPerSecond <= 0) {
+    return wanted;
+  }
+  refill();
+  qint64 granted = std::min(wanted, qint64(tokens));
+  tokens -= granted;
+  return granted;
+}
+
+qint64 TokenBucket::msecsUntilAvailable(qint64 amount) {
+  if (bytesPerSecond <= 0) {
+    return 0;
+  }
+  refill();
+  double missing = std::min(amount, capacity()) - tokens;
+  return (missing <= 0) ? 0 : qint64(missing * 1000 / bytesPerSecond) + 1;
+}
+
+ThrottledDevice::ThrottledDevice(QIODevice* source, TokenBucket* bucket, QObject* parent)
+    : QIODevice(parent) {
+  this->source = source;
+  this->bucket = bucket;
+}
+
+bool ThrottledDevice::open(OpenMode mode) {
+  if ((mode & QIODevice::ReadWrite) != QIODevice::ReadOnly || !source->isOpen()) {
+    setErrorString("ThrottledDevice requires an open source, and is read-only");
+    return false;
+  }
+  return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+bool ThrottledDevice::seek(qint64 pos) { return source->seek(pos) && QIODevice::seek(pos); }
+
+qint64 ThrottledDevice::readData(char* data, qint64 maxSize) {
+  qint64 wanted = std::min(maxSize, size() - pos());
+  if (wanted <= 0) {
+    return 0;
+  }
+  qint64 granted = bucket->take(wanted);
+  if (granted == 0) {
+    scheduleWakeup();
+    return 0;
+  }
+  if (!source->seek(pos())) {
+    setErrorString(source->errorString());
+    return -1;
+  }
+  return source->read(data, granted);
+}
+
+qint64 ThrottledDevice::writeData(const char* data, qint64 maxSize) {
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return -1;
+}
+
+void ThrottledDevice::scheduleWakeup() {
+  if (wakeupPending) {
+    return;
+  }
+  wakeupPending = true;
+  QTimer::singleShot(int(bucket->msecsUntilAvailable(minimumRead)), this, [this]() {
+    wakeupPending = false;
+    emit readyRead();
+  });
+}
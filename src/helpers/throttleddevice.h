@@ -0,0 +1,70 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef THROTTLEDDEVICE_H
+#define THROTTLEDDEVICE_H
+
+#include <QElapsedTimer>
+#include <QIODevice>
+
+/**
+ * @brief The TokenBucket class limits the average rate at which bytes may be consumed. Tokens
+ * (bytes) accumulate at the configured rate, up to a small burst allowance. A single bucket may be
+ * shared between several ThrottledDevices, in which case they share the rate between them.
+ */
+class TokenBucket {
+ public:
+  /// setRate changes the allowed rate. A rate of 0 (or less) disables the limit.
+  void setRate(qint64 bytesPerSecond);
+  qint64 rate() { return bytesPerSecond; }
+
+  /// take removes up to wanted tokens from the bucket, and returns how many were removed
+  qint64 take(qint64 wanted);
+  /// msecsUntilAvailable returns how long until the given number of tokens will be available
+  qint64 msecsUntilAvailable(qint64 amount);
+
+ private:
+  void refill();
+  qint64 capacity();
+
+ private:
+  qint64 bytesPerSecond = 0;
+  double tokens = 0;
+  QElapsedTimer clock;
+};
+
+/**
+ * @brief The ThrottledDevice class is a read-only QIODevice that passes through the contents of
+ * another (random-access) device, no faster than the given TokenBucket allows. When the bucket is
+ * empty, reads return no data, and readyRead is emitted once more data may be read.
+ *
+ * The source device must already be open, and is not owned by this device.
+ */
+class ThrottledDevice : public QIODevice {
+  Q_OBJECT
+
+ public:
+  ThrottledDevice(QIODevice* source, TokenBucket* bucket, QObject* parent = nullptr);
+
+  /// open opens the device. Only ReadOnly is supported.
+  bool open(OpenMode mode) override;
+
+  bool isSequential() const override { return false; }
+  qint64 size() const override { return source->size(); }
+  bool seek(qint64 pos) override;
+
+ protected:
+  qint64 readData(char* data, qint64 maxSize) override;
+  qint64 writeData(const char* data, qint64 maxSize) override;
+
+ private:
+  /// scheduleWakeup emits readyRead once the bucket has refilled a bit
+  void scheduleWakeup();
+
+ private:
+  QIODevice* source;
+  TokenBucket* bucket;
+  bool wakeupPending = false;
+};
+
+#endif  // THROTTLEDDEVICE_H
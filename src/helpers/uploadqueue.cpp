@@ -0,0 +1,370 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include "uploadqueue.h"
+
+#include <QFutureWatcher>
+#include <QRandomGenerator>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "appconfig.h"
+#include "exceptions/fileerror.h"
+#include "helpers/stopreply.h"
+
+// baseRetryDelay and maxRetryDelay bound the wait (in milliseconds) between upload attempts
+static const qint64 baseRetryDelay = 15 * 1000;
+static const qint64 maxRetryDelay = 30 * 60 * 1000;
+
+// stallTimeout is how long (in milliseconds) an upload may go without sending any data, while
+// the request body is still being sent, before it is considered stalled
+static const qint64 stallTimeout = 60 * 1000;
+
+// responseTimeout is how long (in milliseconds) to wait for the server's response once the request
+// body has been sent. The server may be busy processing the evidence by then, so this is longer.
+static const qint64 responseTimeout = 5 * 60 * 1000;
+
+// retryDelay returns how long to wait before the given (1-based) retry attempt: the delay doubles
+// with each attempt (capped at maxRetryDelay), and a random half of it is dropped so that many
+// failed uploads (e.g. after a VPN drop) do not all retry at the same moment.
+static qint64 retryDelay(int attempt) {
+  qint64 delay = baseRetryDelay << std::min(attempt - 1, 16);
+  delay = std::min(delay, maxRetryDelay);
+  return delay / 2 + qint64(QRandomGenerator::global()->bounded(double(delay / 2)));
+}
+
+// isRetryableError returns true if the (failed) reply indicates a problem that may go away on its
+// own: connectivity problems, timeouts, server errors (5xx), and rate limiting (429). Anything else
+// (e.g. 4xx responses, TLS certificate problems) will fail again in the same way.
+static bool isRetryableError(QNetworkReply* reply) {
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (statusCode != 0) {
+    return statusCode >= 500 || statusCode == 429 || statusCode == 408;
+  }
+
+  switch (reply->error()) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::ProxyConnectionRefusedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyNotFoundError:
+    case QNetworkReply::ProxyTimeoutError:
+      return true;
+    default:
+      return false;
+  }
+}
+
+UploadQueue::UploadQueue(DatabaseConnection* db, QObject* parent) : QObject(parent) {
+  this->db = db;
+
+  retryTimer = new QTimer(this);
+  retryTimer->setSingleShot(true);
+  connect(retryTimer, &QTimer::timeout, this, &UploadQueue::onRetryTimeout);
+
+  stallTimer = new QTimer(this);
+  stallTimer->setInterval(int(stallTimeout / 4));
+  connect(stallTimer, &QTimer::timeout, this, &UploadQueue::checkForStalls);
+}
+
+UploadQueue::~UploadQueue() {
+  // in-flight uploads (and those still being prepared) stay marked as queued in the database, and
+  // so are retried by restore.
+  // active is emptied first, so that aborting a reply does not record a failed upload.
+  auto inFlight = std::move(active);
+  active.clear();
+  for (auto entry : inFlight) {
+    auto reply = entry.first;
+    stopReply(&reply);
+  }
+}
+
+void UploadQueue::restore() {
+  auto now = QDateTime::currentDateTimeUtc();
+  try {
+    for (const auto& evi : db->getQueuedEvidence()) {
+      if (!queued.insert(evi.id).second) {
+        continue;
+      }
+      if (evi.nextRetryDate.isValid() && evi.nextRetryDate > now) {
+        retrying.emplace(evi.nextRetryDate, evi.id);
+      }
+      else {
+        pending.push_back(evi.id);
+      }
+    }
+  }
+  catch (QSqlError& e) {
+    std::cout << "Could not restore upload queue. Error: " << e.text().toStdString() << std::endl;
+  }
+  armRetryTimer();
+  startUploads();
+}
+
+void UploadQueue::enqueue(qint64 evidenceID, Priority priority) {
+  enqueue(std::vector<qint64>{evidenceID}, priority);
+}
+
+void UploadQueue::enqueue(const std::vector<qint64>& evidenceIDs, Priority priority) {
+  auto& lane = (priority == PRIORITY_HIGH) ? pendingHigh : pending;
+  std::vector<qint64> newIDs;
+  for (qint64 evidenceID : evidenceIDs) {
+    if (queued.insert(evidenceID).second) {
+      newIDs.push_back(evidenceID);
+    }
+    else if (priority == PRIORITY_HIGH) {
+      // already waiting; move it to the front of the line
+      auto existing = std::find(pending.begin(), pending.end(), evidenceID);
+      if (existing != pending.end()) {
+        pending.erase(existing);
+        pendingHigh.push_back(evidenceID);
+      }
+    }
+  }
+  if (newIDs.empty()) {
+    startUploads();
+    return;
+  }
+  try {
+    db->updateEvidenceQueued(true, newIDs);
+  }
+  catch (QSqlError& e) {
+    // still worth trying the uploads -- they just won't survive a restart
+    std::cout << "Could not record queued uploads. Error: " << e.text().toStdString() << std::endl;
+  }
+  lane.insert(lane.end(), newIDs.begin(), newIDs.end());
+  startUploads();
+}
+
+bool UploadQueue::isQueued(qint64 evidenceID) { return queued.count(evidenceID) > 0; }
+
+void UploadQueue::setPaused(bool paused) {
+  if (this->paused == paused) {
+    return;
+  }
+  this->paused = paused;
+  if (!paused) {
+    for (const auto& entry : retrying) {
+      pending.push_back(entry.second);
+    }
+    retrying.clear();
+    armRetryTimer();
+    startUploads();
+  }
+}
+
+void UploadQueue::startUploads() {
+  size_t slots = size_t(std::max(1, AppConfig::getInstance().maxConcurrentUploads));
+
+  while (!paused && !(pending.empty() && pendingHigh.empty())) {
+    bool highPriority = !pendingHigh.empty();
+    if (active.size() + preparing.size() >= slots + (highPriority ? 1 : 0)) {
+      break;
+    }
+    auto& lane = highPriority ? pendingHigh : pending;
+    qint64 evidenceID = lane.front();
+    lane.pop_front();
+
+    model::Evidence evi;
+    try {
+      evi = db->getEvidenceDetails(evidenceID);
+    }
+    catch (QSqlError& e) {
+      finishUpload(evidenceID, false,
+                   "Unable to upload evidence: Could not read local data (" + e.text() + ")");
+      continue;
+    }
+    if (evi.id == 0) {
+      queued.erase(evidenceID);  // evidence was deleted while waiting
+      continue;
+    }
+
+    // signing the upload means hashing the whole file, so that is done in the background
+    preparing.insert(evidenceID);
+    auto watcher = new QFutureWatcher<NetMan::PreparedUpload>(this);
+    connect(watcher, &QFutureWatcher<NetMan::PreparedUpload>::finished, this,
+            [this, watcher, evidenceID]() {
+              auto upload = watcher->result();
+              watcher->deleteLater();
+              preparing.erase(evidenceID);
+              sendUpload(upload);
+              startUploads();
+            });
+    watcher->setFuture(QtConcurrent::run(&NetMan::prepareUpload, evi));
+  }
+  if (active.empty()) {
+    stallTimer->stop();
+  }
+  else if (!stallTimer->isActive()) {
+    stallTimer->start();
+  }
+  emit queueChanged(pendingCount(), activeCount());
+}
+
+void UploadQueue::sendUpload(const NetMan::PreparedUpload& upload) {
+  qint64 evidenceID = upload.evidence.id;
+  if (!upload.errorText.isEmpty()) {
+    finishUpload(evidenceID, false, "Unable to upload evidence: " + upload.errorText);
+    return;
+  }
+  if (paused) {
+    pending.push_front(evidenceID);  // went offline while this was being prepared
+    return;
+  }
+  try {
+    int priorAttempts = upload.evidence.uploadAttempts;
+    auto reply = NetMan::getInstance().uploadAsset(upload);
+    active.emplace(reply, ActiveUpload{evidenceID, QDateTime::currentMSecsSinceEpoch(), false,
+                                       ActiveUpload::NOT_TIMED_OUT});
+    auto markActivity = [this, reply](bool bodySent) {
+      auto entry = active.find(reply);
+      if (entry != active.end()) {
+        entry->second.lastActivity = QDateTime::currentMSecsSinceEpoch();
+        entry->second.bodySent = entry->second.bodySent || bodySent;
+      }
+    };
+    connect(reply, &QNetworkReply::uploadProgress, this,
+            [this, evidenceID, markActivity](qint64 bytesSent, qint64 bytesTotal) {
+              markActivity(bytesTotal > 0 && bytesSent >= bytesTotal);
+              emit uploadProgress(evidenceID, bytesSent, bytesTotal);
+            });
+    // receiving any part of the response means the whole request has been sent
+    connect(reply, &QNetworkReply::downloadProgress, this,
+            [markActivity]() { markActivity(true); });
+    connect(reply, &QNetworkReply::finished, this,
+            [this, reply, priorAttempts]() { onUploadComplete(reply, priorAttempts); });
+    emit uploadStarted(evidenceID);
+  }
+  catch (FileError& e) {
+    finishUpload(evidenceID, false, "Unable to upload evidence: " + QString(e.what()));
+  }
+}
+
+void UploadQueue::onUploadComplete(QNetworkReply* reply, int priorAttempts) {
+  auto entry = active.find(reply);
+  if (entry == active.end()) {
+    return;
+  }
+  qint64 evidenceID = entry->second.evidenceID;
+  auto timeout = entry->second.timeout;
+  active.erase(entry);
+
+  bool isValid;
+  NetMan::extractResponse(reply, isValid);
+  QString errMessage;
+  bool retryable = false;
+  if (timeout == ActiveUpload::STALLED) {
+    errMessage = QString("Unable to upload evidence: Network error (no progress for %1 seconds)")
+                     .arg(stallTimeout / 1000);
+    retryable = true;
+  }
+  else if (timeout == ActiveUpload::NO_RESPONSE) {
+    // the server has the whole request, and may yet have stored the evidence, so sending it again
+    // could create a duplicate. Leave it to the user to check, and resubmit if need be.
+    errMessage = QString("Unable to upload evidence: No response from the server within %1 "
+                         "seconds (the evidence may have been uploaded anyway)")
+                     .arg(responseTimeout / 1000);
+  }
+  else if (!isValid) {
+    errMessage = "Unable to upload evidence: Network error (" + reply->errorString() + ")";
+    retryable = isRetryableError(reply);
+  }
+  tidyReply(&reply);
+
+  int attempt = priorAttempts + 1;
+  if (retryable && attempt < AppConfig::getInstance().maxUploadAttempts) {
+    scheduleRetry(evidenceID, attempt, errMessage);
+  }
+  else {
+    finishUpload(evidenceID, isValid, errMessage);
+  }
+  startUploads();
+}
+
+void UploadQueue::scheduleRetry(qint64 evidenceID, int attempt, const QString& errorText) {
+  auto nextAttempt = QDateTime::currentDateTimeUtc().addMSecs(retryDelay(attempt));
+  try {
+    db->updateEvidenceRetry(errorText, attempt, nextAttempt, evidenceID);
+  }
+  catch (QSqlError& e) {
+    std::cout << "Could not record upload retry. Error: " << e.text().toStdString() << std::endl;
+  }
+  retrying.emplace(nextAttempt, evidenceID);
+  armRetryTimer();
+  emit uploadRetryScheduled(evidenceID, attempt, nextAttempt, errorText);
+}
+
+void UploadQueue::armRetryTimer() {
+  if (retrying.empty()) {
+    retryTimer->stop();
+    return;
+  }
+  qint64 wait = QDateTime::currentDateTimeUtc().msecsTo(retrying.begin()->first);
+  retryTimer->start(int(std::max(qint64(0), wait)));
+}
+
+void UploadQueue::onRetryTimeout() {
+  auto now = QDateTime::currentDateTimeUtc();
+  while (!retrying.empty() && retrying.begin()->first <= now) {
+    pending.push_back(retrying.begin()->second);
+    retrying.erase(retrying.begin());
+  }
+  armRetryTimer();
+  startUploads();
+}
+
+void UploadQueue::checkForStalls() {
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  std::vector<QNetworkReply*> stalledReplies;
+  for (auto& entry : active) {
+    auto& upload = entry.second;
+    if (upload.timeout != ActiveUpload::NOT_TIMED_OUT) {
+      continue;
+    }
+    qint64 idle = now - upload.lastActivity;
+    if (!upload.bodySent && idle > stallTimeout) {
+      upload.timeout = ActiveUpload::STALLED;
+      stalledReplies.push_back(entry.first);
+    }
+    else if (upload.bodySent && idle > responseTimeout) {
+      upload.timeout = ActiveUpload::NO_RESPONSE;
+      stalledReplies.push_back(entry.first);
+    }
+  }
+  // aborting finishes (and removes) the upload, so this is done after iterating
+  for (auto reply : stalledReplies) {
+    auto& upload = active.at(reply);
+    std::cout << "Upload for evidence " << upload.evidenceID
+              << (upload.timeout == ActiveUpload::STALLED ? " stalled"
+                                                          : " received no response")
+              << "; aborting" << std::endl;
+    reply->abort();
+  }
+}
+
+void UploadQueue::finishUpload(qint64 evidenceID, bool success, const QString& errorText) {
+  queued.erase(evidenceID);
+  try {
+    if (success) {
+      db->updateEvidenceSubmitted(evidenceID);
+    }
+    else {
+      db->updateEvidenceError(errorText, evidenceID);
+    }
+    db->updateEvidenceQueued(false, evidenceID);
+  }
+  catch (QSqlError& e) {
+    std::cout << "Upload " << (success ? "successful" : "failed")
+              << ". Could not update internal database. Error: " << e.text().toStdString()
+              << std::endl;
+  }
+  emit uploadFinished(evidenceID, success, errorText);
+}
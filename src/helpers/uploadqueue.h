@@ -0,0 +1,150 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#ifndef UPLOADQUEUE_H
+#define UPLOADQUEUE_H
+
+#include <QDateTime>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "db/databaseconnection.h"
+#include "helpers/netman.h"
+
+/**
+ * @brief The UploadQueue class uploads evidence in the background. Queued evidence is recorded in
+ * the local database (see DatabaseConnection::updateEvidenceQueued), so that anything still pending
+ * when the application closes is picked back up (via restore) on the next launch.
+ *
+ * Up to AppConfig::maxConcurrentUploads uploads are in flight at once. Each upload's body is hashed
+ * (to sign the request) on a background thread before it is sent. Progress and results are
+ * reported via signals; the database is updated (submitted/error) before uploadFinished is emitted.
+ *
+ * Uploads that fail for transient reasons (network errors, 5xx / 429 responses) are retried with
+ * exponential backoff and jitter, up to AppConfig::maxUploadAttempts attempts. The attempt count
+ * and next retry time are stored with the evidence, so pending retries also survive a restart.
+ *
+ * The ASHIRT API accepts evidence only as a single request, so an interrupted upload cannot be
+ * resumed part way through. To limit the cost of a dead connection, uploads that make no progress
+ * for a while are treated as stalled: they are aborted and retried, rather than left to wait out
+ * the operating system's TCP timeout. Once the request has been fully sent, the server may already
+ * be storing the evidence, so an upload whose response does not arrive (within a longer timeout)
+ * is aborted and marked as failed, but is not retried automatically.
+ */
+class UploadQueue : public QObject {
+  Q_OBJECT
+
+ public:
+  /// Priority determines which evidence is uploaded first. High priority evidence (e.g. a fresh
+  /// capture) is uploaded before any normal priority evidence (e.g. a bulk submission), and may use
+  /// one upload slot beyond AppConfig::maxConcurrentUploads.
+  enum Priority {
+    PRIORITY_NORMAL,
+    PRIORITY_HIGH,
+  };
+
+  explicit UploadQueue(DatabaseConnection* db, QObject* parent = nullptr);
+  ~UploadQueue();
+
+  /// restore queues any evidence that was marked as queued, but never uploaded (e.g. because the
+  /// application was closed mid-upload)
+  void restore();
+  /// enqueue marks the given evidence as queued, and uploads it once an upload slot is available.
+  /// Evidence that is already queued is ignored (though it may be moved to a higher priority).
+  void enqueue(qint64 evidenceID, Priority priority = PRIORITY_NORMAL);
+  /// enqueue marks all of the given evidence as queued (in a single database transaction), and
+  /// uploads them as upload slots become available. Evidence that is already queued is ignored
+  /// (though it may be moved to a higher priority).
+  void enqueue(const std::vector<qint64>& evidenceIDs, Priority priority = PRIORITY_NORMAL);
+  /// isQueued returns true if the given evidence is waiting to be uploaded (including waiting to
+  /// retry), or is being uploaded
+  bool isQueued(qint64 evidenceID);
+
+  /// pendingCount returns the number of evidence waiting for an upload slot
+  int pendingCount() { return int(pending.size() + pendingHigh.size()); }
+  /// activeCount returns the number of uploads currently in flight (including those still being
+  /// prepared)
+  int activeCount() { return int(active.size() + preparing.size()); }
+  /// retryingCount returns the number of evidence waiting for a scheduled retry
+  int retryingCount() { return int(retrying.size()); }
+
+  /// setPaused stops (or resumes) starting new uploads. Uploads already in flight are unaffected.
+  /// Resuming also brings any scheduled retries forward, so that the backlog drains right away.
+  void setPaused(bool paused);
+  bool isPaused() { return paused; }
+
+ signals:
+  /// uploadStarted is emitted when the given evidence's upload request has been sent
+  void uploadStarted(qint64 evidenceID);
+  /// uploadProgress is emitted as the given evidence's upload request body is sent
+  void uploadProgress(qint64 evidenceID, qint64 bytesSent, qint64 bytesTotal);
+  /// uploadFinished is emitted once an upload completes (successfully or not) and the database
+  /// has been updated to reflect this.
+  void uploadFinished(qint64 evidenceID, bool success, QString errorText);
+  /// uploadRetryScheduled is emitted when an upload attempt fails with a retryable error, and
+  /// another attempt has been scheduled (and recorded in the database).
+  void uploadRetryScheduled(qint64 evidenceID, int attempt, QDateTime nextAttempt,
+                            QString errorText);
+  /// queueChanged is emitted whenever the number of pending or active uploads changes
+  void queueChanged(int pending, int active);
+
+ private:
+  /// startUploads starts uploading pending evidence until all upload slots are in use
+  void startUploads();
+  /// sendUpload sends the given prepared upload, or records its failure if it could not be prepared
+  void sendUpload(const NetMan::PreparedUpload& upload);
+  /// onUploadComplete records the result of the given upload request, then frees its slot.
+  /// priorAttempts is the number of failed attempts made before this request.
+  void onUploadComplete(QNetworkReply* reply, int priorAttempts);
+  /// scheduleRetry records the failed attempt, and queues the evidence to be tried again later
+  void scheduleRetry(qint64 evidenceID, int attempt, const QString& errorText);
+  /// armRetryTimer (re)starts the retry timer for the earliest scheduled retry, if any
+  void armRetryTimer();
+  /// onRetryTimeout moves every retry that is now due back into the pending queue
+  void onRetryTimeout();
+  /// checkForStalls aborts any in-flight upload that has not made progress recently, or has not
+  /// received a response to its (fully sent) request
+  void checkForStalls();
+  /// finishUpload records the result for the given evidence and notifies listeners
+  void finishUpload(qint64 evidenceID, bool success, const QString& errorText);
+
+ private:
+  /// db is a (shared) reference to the local database instance. Not to be deleted.
+  DatabaseConnection* db;
+
+  std::deque<qint64> pending;
+  std::deque<qint64> pendingHigh;
+  /// preparing holds the evidence whose upload body is being hashed (see NetMan::prepareUpload)
+  std::unordered_set<qint64> preparing;
+  /// ActiveUpload tracks an in-flight upload request
+  struct ActiveUpload {
+    qint64 evidenceID;
+    /// lastActivity is the time (msecs since epoch) data was last sent or received
+    qint64 lastActivity;
+    /// bodySent is true once the whole request has been sent, and only the response is awaited
+    bool bodySent;
+    /// Timeout records why (if at all) the upload was aborted by checkForStalls
+    enum Timeout {
+      NOT_TIMED_OUT,
+      STALLED,
+      NO_RESPONSE,
+    } timeout;
+  };
+  std::unordered_map<QNetworkReply*, ActiveUpload> active;
+  /// retrying maps the time of each evidence's next attempt to the evidence ID
+  std::multimap<QDateTime, qint64> retrying;
+  /// queued contains every evidence ID that is pending, preparing, active or retrying
+  std::unordered_set<qint64> queued;
+
+  QTimer* retryTimer = nullptr;
+  QTimer* stallTimer = nullptr;
+  bool paused = false;
+};
+
+#endif  // UPLOADQUEUE_H
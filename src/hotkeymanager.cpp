@@ -34,6 +34,9 @@ void HotkeyManager::hotkeyTriggered(size_t hotkeyIndex) {
   else if (hotkeyIndex == ACTION_CAPTURE_CODEBLOCK) {
     emit codeblockHotkeyPressed();
   }
+  else if (hotkeyIndex == ACTION_CAPTURE_BURST) {
+    emit captureBurstHotkeyPressed();
+  }
 }
 
 void HotkeyManager::updateHotkeys() {
@@ -46,4 +49,5 @@ void HotkeyManager::updateHotkeys() {
   regKey(AppConfig::getInstance().screenshotShortcutCombo, ACTION_CAPTURE_AREA);
   regKey(AppConfig::getInstance().captureWindowShortcut, ACTION_CAPTURE_WINDOW);
   regKey(AppConfig::getInstance().captureCodeblockShortcut, ACTION_CAPTURE_CODEBLOCK);
+  regKey(AppConfig::getInstance().captureBurstShortcut, ACTION_CAPTURE_BURST);
 }
@@ -26,6 +26,7 @@ class HotkeyManager : public QObject {
     ACTION_CAPTURE_AREA = 2,
     ACTION_CAPTURE_WINDOW = 3,
     ACTION_CAPTURE_CODEBLOCK = 4,
+    ACTION_CAPTURE_BURST = 5,
   };
 
  public:
@@ -46,6 +47,8 @@ class HotkeyManager : public QObject {
   void captureWindowHotkeyPressed();
   /// captureAreaHotkeyPressed signals when the ACTION_CAPTURE_AREA event has been triggered.
   void captureAreaHotkeyPressed();
+  /// captureBurstHotkeyPressed signals when the ACTION_CAPTURE_BURST event has been triggered.
+  void captureBurstHotkeyPressed();
 
  public slots:
   /// updateHotkeys retrives AppConfig data to set known global hotkeys. Removes _all_ (Application)
@@ -15,6 +15,7 @@ void handleCLI(std::vector<std::string> args);
 #include "appconfig.h"
 #include "appsettings.h"
 #include "db/databaseconnection.h"
+#include "db/databaseworker.h"
 #include "exceptions/databaseerr.h"
 #include "exceptions/fileerror.h"
 #include "traymanager.h"
@@ -59,9 +60,11 @@ int main(int argc, char* argv[]) {
   QCoreApplication::setApplicationName("ashirt");
 
   DatabaseConnection* conn;
+  DatabaseWorker* dbWorker = nullptr;
   try {
     conn = new DatabaseConnection();
     conn->connect();
+    dbWorker = new DatabaseWorker(conn);
   }
   catch (FileError& err) {
     std::cout << err.what() << std::endl;
@@ -97,10 +100,14 @@ int main(int argc, char* argv[]) {
     }
     QApplication::setQuitOnLastWindowClosed(false);
 
-    auto window = new TrayManager(conn);
+    auto window = new TrayManager(conn, dbWorker);
     rtn = app.exec();
     AppSettings::getInstance().sync();
     delete window;
+    // while the application still exists: this waits for any queued database work (e.g. deletes)
+    // to finish, then closes the worker's connection on its own thread
+    delete dbWorker;
+    dbWorker = nullptr;
   }
   catch (std::exception const& ex) {
     std::cout << "Exception while running: " << ex.what() << std::endl;
@@ -108,6 +115,7 @@ int main(int argc, char* argv[]) {
   catch (...) {
     std::cout << "Unhandled exception while running" << std::endl;
   }
+  delete dbWorker;  // only still set if the application failed to run
   conn->close();
   delete conn;
 
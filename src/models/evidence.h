@@ -12,7 +12,7 @@
 namespace model {
 class Evidence {
  public:
-  qint64 id;
+  qint64 id = 0;
   QString path;
   QString operationSlug;
   QString description;
@@ -20,6 +20,14 @@ class Evidence {
   QString contentType;
   QDateTime recordedDate;
   QDateTime uploadDate;
+  QDateTime queuedDate;
+  int uploadAttempts = 0;
+  QDateTime nextRetryDate;
+  QString contentHash;
+  /// perceptualHash is the image's difference hash (see PerceptualHash). Empty if not computed.
+  QString perceptualHash;
+  /// seriesID groups evidence captured together (e.g. a burst capture). 0 if not in a series.
+  qint64 seriesID = 0;
   std::vector<Tag> tags;
 };
 }  // namespace model
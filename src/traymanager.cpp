@@ -12,6 +12,7 @@
 #include <QComboBox>
 #include <QCoreApplication>
 #include <QDesktopWidget>
+#include <QFile>
 #include <QGroupBox>
 #include <QLabel>
 #include <QLineEdit>
@@ -24,13 +25,17 @@
 #include <iostream>
 #include <QTimer>
 #include <QDesktopServices>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include "appconfig.h"
 #include "appsettings.h"
 #include "db/databaseconnection.h"
 #include "forms/getinfo/getinfo.h"
 #include "helpers/clipboard/clipboardhelper.h"
+#include "helpers/file_helpers.h"
 #include "helpers/netman.h"
+#include "helpers/perceptualhash.h"
 #include "helpers/screenshot.h"
 #include "helpers/constants.h"
 #include "hotkeymanager.h"
@@ -50,10 +55,15 @@
 #define ICON ":/icons/shirt-light.svg"
 #endif
 
-TrayManager::TrayManager(DatabaseConnection* db) {
+TrayManager::TrayManager(DatabaseConnection* db, DatabaseWorker* dbWorker) {
   this->db = db;
+  this->dbWorker = dbWorker;
 
   screenshotTool = new Screenshot();
+  burstTool = new BurstCapture(this);
+  uploadQueue = new UploadQueue(db, this);
+  connectivityMonitor = new ConnectivityMonitor(this);
+  uploadQueue->setPaused(!connectivityMonitor->isOnline());
   hotkeyManager = new HotkeyManager();
   hotkeyManager->updateHotkeys();
   updateCheckTimer = new QTimer(this);
@@ -63,8 +73,12 @@ TrayManager::TrayManager(DatabaseConnection* db) {
   wireUi();
 
   // delayed so that windows can listen for get all ops signal
-  NetMan::getInstance().refreshOperationsList();
+  if (!connectivityMonitor->isOfflineMode()) {
+    NetMan::getInstance().refreshOperationsList();
+  }
+  uploadQueue->restore();
   QTimer::singleShot(5000, this, &TrayManager::checkForUpdate);
+  backfillPerceptualHashes();
 }
 
 TrayManager::~TrayManager() {
@@ -75,9 +89,11 @@ TrayManager::~TrayManager() {
   delete currentOperationMenuAction;
   delete captureScreenAreaAction;
   delete captureWindowAction;
+  delete captureBurstAction;
   delete showEvidenceManagerAction;
   delete showCreditsAction;
   delete addCodeblockAction;
+  delete workOfflineAction;
   cleanChooseOpSubmenu();  // must be done before deleting chooseOpSubmenu/action
 
   delete chooseOpStatusAction;
@@ -92,12 +108,14 @@ TrayManager::~TrayManager() {
   delete settingsWindow;
   delete evidenceManagerWindow;
   delete creditsWindow;
+  delete uploadQueue;
+  delete connectivityMonitor;
 }
 
 void TrayManager::buildUi() {
   // create subwindows
   settingsWindow = new Settings(hotkeyManager, this);
-  evidenceManagerWindow = new EvidenceManager(db, this);
+  evidenceManagerWindow = new EvidenceManager(db, dbWorker, uploadQueue, this);
   creditsWindow = new Credits(this);
   createOperationWindow = new CreateOperation(this);
 
@@ -114,8 +132,10 @@ void TrayManager::buildUi() {
   addToTray(tr("Add Codeblock from Clipboard"), &addCodeblockAction);
   addToTray(tr("Capture Screen Area"), &captureScreenAreaAction);
   addToTray(tr("Capture Window"), &captureWindowAction);
+  addToTray(tr("Capture Burst"), &captureBurstAction);
   addToTray(tr("View Accumulated Evidence"), &showEvidenceManagerAction);
   addToTray(tr("Settings"), &showSettingsAction);
+  addToTray(tr("Work Offline"), &workOfflineAction);
   trayIconMenu->addSeparator();
   addToTray(tr(""), &currentOperationMenuAction);
   trayIconMenu->addMenu(chooseOpSubmenu);
@@ -132,6 +152,14 @@ void TrayManager::buildUi() {
   chooseOpSubmenu->addAction(chooseOpStatusAction);
   chooseOpSubmenu->addAction(newOperationAction);
   chooseOpSubmenu->addSeparator();
+  workOfflineAction->setCheckable(true);
+  workOfflineAction->setChecked(connectivityMonitor->isOfflineMode());
+
+  // show the last known operations until the server responds (or indefinitely, if offline)
+  populateChooseOpSubmenu(AppSettings::getInstance().getCachedOperations());
+  if (connectivityMonitor->isOfflineMode()) {
+    chooseOpStatusAction->setText(tr("Offline: showing last known operations"));
+  }
 
   setActiveOperationLabel();
 
@@ -159,13 +187,20 @@ void TrayManager::wireUi() {
   connect(showSettingsAction, actTriggered, [this, toTop](){toTop(settingsWindow);});
   connect(captureScreenAreaAction, actTriggered, this, &TrayManager::captureAreaActionTriggered);
   connect(captureWindowAction, actTriggered, this, &TrayManager::captureWindowActionTriggered);
+  connect(captureBurstAction, actTriggered, this, &TrayManager::captureBurstActionTriggered);
   connect(showEvidenceManagerAction, actTriggered, [this, toTop](){toTop(evidenceManagerWindow);});
   connect(showCreditsAction, actTriggered, [this, toTop](){toTop(creditsWindow);});
   connect(addCodeblockAction, actTriggered, this, &TrayManager::captureCodeblockActionTriggered);
   connect(newOperationAction, actTriggered, [this, toTop](){toTop(createOperationWindow);});
+  connect(workOfflineAction, &QAction::toggled,
+          [this](bool offline) { connectivityMonitor->setOfflineMode(offline); });
 
   connect(screenshotTool, &Screenshot::onScreenshotCaptured, this,
           &TrayManager::onScreenshotCaptured);
+  connect(burstTool, &BurstCapture::burstCaptured, this, &TrayManager::onBurstCaptured);
+  connect(screenshotTool, &Screenshot::onScreenshotFailed, [this](QString errorText) {
+    trayIcon->showMessage("Unable to Capture", errorText, QSystemTrayIcon::Warning);
+  });
 
   // connect to hotkey signals
   connect(hotkeyManager, &HotkeyManager::codeblockHotkeyPressed, this,
@@ -174,6 +209,8 @@ void TrayManager::wireUi() {
           &TrayManager::captureAreaActionTriggered);
   connect(hotkeyManager, &HotkeyManager::captureWindowHotkeyPressed, this,
           &TrayManager::captureWindowActionTriggered);
+  connect(hotkeyManager, &HotkeyManager::captureBurstHotkeyPressed, this,
+          &TrayManager::captureBurstActionTriggered);
 
   // connect to network signals
   connect(&NetMan::getInstance(), &NetMan::operationListUpdated, this,
@@ -181,9 +218,17 @@ void TrayManager::wireUi() {
   connect(&NetMan::getInstance(), &NetMan::releasesChecked, this, &TrayManager::onReleaseCheck);
   connect(&AppSettings::getInstance(), &AppSettings::onOperationUpdated, this,
           &TrayManager::setActiveOperationLabel);
+  connect(connectivityMonitor, &ConnectivityMonitor::connectivityChanged, this,
+          &TrayManager::onConnectivityChanged);
+  // a failed upload is a good hint that the connection may have dropped
+  connect(uploadQueue, &UploadQueue::uploadRetryScheduled, connectivityMonitor,
+          &ConnectivityMonitor::checkNow);
   
   connect(trayIcon, &QSystemTrayIcon::messageClicked, [](){QDesktopServices::openUrl(Constants::releasePageUrl());});
   connect(trayIcon, &QSystemTrayIcon::activated, [this] {
+    if (!connectivityMonitor->isOnline()) {
+      return;  // keep showing the last known operations; refreshed once back online
+    }
     chooseOpStatusAction->setText("Loading operations...");
     newOperationAction->setEnabled(false);
     NetMan::getInstance().refreshOperationsList();
@@ -215,7 +260,7 @@ void TrayManager::closeEvent(QCloseEvent* event) {
 }
 
 void TrayManager::spawnGetInfoWindow(qint64 evidenceID) {
-  auto getInfoWindow = new GetInfo(db, evidenceID, this);
+  auto getInfoWindow = new GetInfo(db, uploadQueue, evidenceID, this);
   connect(getInfoWindow, &GetInfo::evidenceSubmitted, [](model::Evidence evi){
     AppSettings::getInstance().setLastUsedTags(evi.tags);
   });
@@ -229,14 +274,106 @@ qint64 TrayManager::createNewEvidence(QString filepath, QString evidenceType) {
   if (tags.size() > 0) {
     db->setEvidenceTags(tags, evidenceID);
   }
+  computeContentHash(evidenceID, filepath);
+  if (evidenceType == "image") {
+    computePerceptualHash(evidenceID, filepath);
+  }
   return evidenceID;
 }
 
+void TrayManager::computeContentHash(qint64 evidenceID, QString filepath) {
+  // hashed off the UI thread, so large captures do not delay showing the GetInfo window
+  auto watcher = new QFutureWatcher<QString>(this);
+  connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, evidenceID]() {
+    auto contentHash = watcher->result();
+    watcher->deleteLater();
+    if (contentHash.isEmpty()) {
+      return;
+    }
+    try {
+      db->updateEvidenceContentHash(contentHash, evidenceID);
+    }
+    catch (QSqlError& e) {
+      std::cout << "Could not record evidence hash. Error: " << e.text().toStdString() << std::endl;
+    }
+  });
+  watcher->setFuture(QtConcurrent::run(FileHelpers::sha256File, filepath));
+}
+
+void TrayManager::computePerceptualHash(qint64 evidenceID, QString filepath) {
+  // decoding the image is slow, so this is also done in the background (see computeContentHash)
+  auto watcher = new QFutureWatcher<QString>(this);
+  connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, evidenceID]() {
+    auto perceptualHash = watcher->result();
+    watcher->deleteLater();
+    if (perceptualHash.isEmpty()) {
+      return;
+    }
+    try {
+      db->updateEvidencePerceptualHash(perceptualHash, evidenceID);
+    }
+    catch (QSqlError& e) {
+      std::cout << "Could not record evidence perceptual hash. Error: " << e.text().toStdString()
+                << std::endl;
+    }
+  });
+  watcher->setFuture(QtConcurrent::run(PerceptualHash::dHashFile, filepath));
+}
+
+// backfillPerceptualHashes records the given (just computed) perceptual hashes, then hashes the
+// next batch of image evidence (after afterID) that has none, until all of it has been hashed.
+// Evidence recorded before perceptual hashing was added (or whose hash was cleared by a later hash
+// format) is hashed this way. The database work is done on the database worker, and the hashing on
+// the global thread pool, a batch at a time, so neither the UI nor the worker is held up for long.
+void TrayManager::backfillPerceptualHashes(qint64 afterID,
+                                           const std::vector<model::Evidence>& hashed) {
+  static const int batchSize = 20;
+  auto batchWatcher = new QFutureWatcher<std::vector<model::Evidence>>(this);
+  connect(batchWatcher, &QFutureWatcher<std::vector<model::Evidence>>::finished, this,
+          [this, batchWatcher]() {
+            auto batch = batchWatcher->result();
+            batchWatcher->deleteLater();
+            if (batch.empty()) {
+              return;  // all hashed (or the database could not be read)
+            }
+            auto hashWatcher = new QFutureWatcher<std::vector<model::Evidence>>(this);
+            connect(hashWatcher, &QFutureWatcher<std::vector<model::Evidence>>::finished, this,
+                    [this, hashWatcher]() {
+                      auto hashedBatch = hashWatcher->result();
+                      hashWatcher->deleteLater();
+                      backfillPerceptualHashes(hashedBatch.back().id, hashedBatch);
+                    });
+            hashWatcher->setFuture(QtConcurrent::run([batch]() {
+              auto rtn = batch;
+              for (auto& evi : rtn) {
+                // unreadable images get an empty hash, so that they are not tried again
+                evi.perceptualHash = PerceptualHash::dHashFile(evi.path);
+              }
+              return rtn;
+            }));
+          });
+  batchWatcher->setFuture(dbWorker->run([afterID, hashed](DatabaseConnection* workerDb) {
+    std::vector<model::Evidence> batch;
+    try {
+      for (const auto& evi : hashed) {
+        workerDb->updateEvidencePerceptualHash(evi.perceptualHash, evi.id);
+      }
+      batch = workerDb->getUnhashedImageEvidence(afterID, batchSize);
+    }
+    catch (QSqlError& e) {
+      std::cout << "Could not record evidence perceptual hashes. Error: " << e.text().toStdString()
+                << std::endl;
+    }
+    return batch;
+  }));
+}
+
 void TrayManager::captureWindowActionTriggered() {
   if(AppSettings::getInstance().operationSlug() == "") {
     showNoOperationSetTrayMessage();
     return;
   }
+  prewarmConnection();
   screenshotTool->captureWindow();
 }
 
@@ -245,14 +382,100 @@ void TrayManager::captureAreaActionTriggered() {
     showNoOperationSetTrayMessage();
     return;
   }
+  prewarmConnection();
   screenshotTool->captureArea();
 }
 
+void TrayManager::captureBurstActionTriggered() {
+  if(AppSettings::getInstance().operationSlug() == "") {
+    showNoOperationSetTrayMessage();
+    return;
+  }
+  prewarmConnection();
+  auto& conf = AppConfig::getInstance();
+  burstTool->start(conf.burstFrameCount, conf.burstIntervalMs, conf.burstBufferFrames);
+}
+
+void TrayManager::onBurstCaptured(std::vector<model::Evidence> frames, int droppedFrames) {
+  if (frames.empty()) {
+    trayIcon->showMessage("Unable to Record Evidence", "No frames could be captured",
+                          QSystemTrayIcon::Warning);
+    return;
+  }
+  AppSettings& inst = AppSettings::getInstance();
+  for (auto& frame : frames) {
+    frame.operationSlug = inst.operationSlug();
+    frame.contentType = "image";
+  }
+  auto tags = inst.getLastUsedTags();
+
+  // saved as one series, in a single transaction on the database worker (rather than a row, and a
+  // GetInfo window, per frame)
+  struct SeriesResult {
+    std::vector<qint64> evidenceIDs;
+    QString errorText;
+  };
+  auto watcher = new QFutureWatcher<SeriesResult>(this);
+  connect(watcher, &QFutureWatcher<SeriesResult>::finished, this,
+          [this, watcher, droppedFrames]() {
+            auto result = watcher->result();
+            watcher->deleteLater();
+            if (result.evidenceIDs.empty()) {
+              trayIcon->showMessage("Unable to Record Evidence",
+                                    "The burst could not be saved, and its frames were discarded. "
+                                    "(Error: " + result.errorText + ")",
+                                    QSystemTrayIcon::Warning);
+              return;
+            }
+            QString msg = QString("Captured %1 frames as series %2.")
+                              .arg(result.evidenceIDs.size())
+                              .arg(result.evidenceIDs.front());
+            if (droppedFrames > 0) {
+              msg += QString(" %1 frames were dropped.").arg(droppedFrames);
+            }
+            trayIcon->showMessage("Burst Captured",
+                                  msg + " Find them in the Evidence Manager with " +
+                                      FILTER_KEY_SERIES + ": " +
+                                      QString::number(result.evidenceIDs.front()),
+                                  QSystemTrayIcon::Information);
+          });
+  watcher->setFuture(dbWorker->run([frames, tags](DatabaseConnection* workerDb) {
+    SeriesResult result;
+    try {
+      result.evidenceIDs = workerDb->createEvidenceSeries(frames);
+      if (!tags.empty()) {
+        workerDb->setEvidenceTags(tags, result.evidenceIDs);
+      }
+    }
+    catch (QSqlError& e) {
+      std::cout << "could not write to the database: " << e.text().toStdString() << std::endl;
+      result.errorText = e.text();
+      if (!result.evidenceIDs.empty()) {
+        // the series was saved, but not its tags: remove it, rather than leave it half done
+        try {
+          workerDb->deleteEvidence(result.evidenceIDs);
+        }
+        catch (QSqlError& cleanupErr) {
+          std::cout << "could not remove the untagged series: " << cleanupErr.text().toStdString()
+                    << std::endl;
+        }
+        result.evidenceIDs.clear();
+      }
+      // nothing refers to the frames now, so don't leave them in the evidence directory
+      for (const auto& frame : frames) {
+        QFile::remove(frame.path);
+      }
+    }
+    return result;
+  }));
+}
+
 void TrayManager::captureCodeblockActionTriggered() {
   if(AppSettings::getInstance().operationSlug() == "") {
     showNoOperationSetTrayMessage();
     return;
   }
+  prewarmConnection();
   onCodeblockCapture();
 }
 
@@ -281,6 +504,13 @@ void TrayManager::onScreenshotCaptured(const QString& path) {
   }
 }
 
+void TrayManager::prewarmConnection() {
+  // the capture will likely be submitted shortly; get the connection ready while the user works
+  if (connectivityMonitor->isOnline()) {
+    NetMan::getInstance().prewarmConnection();
+  }
+}
+
 void TrayManager::showNoOperationSetTrayMessage() {
   trayIcon->showMessage("Unable to Record Evidence",
                         "No Operation has been selected. Please select an operation first.",
@@ -298,42 +528,62 @@ void TrayManager::setActiveOperationLabel() {
 
 void TrayManager::onOperationListUpdated(bool success,
                                          const std::vector<dto::Operation>& operations) {
-  auto currentOp = AppSettings::getInstance().operationSlug();
-
   if (success) {
     chooseOpStatusAction->setText(tr("Operations loaded"));
     newOperationAction->setEnabled(true);
-    cleanChooseOpSubmenu();
+    AppSettings::getInstance().setCachedOperations(operations);
+    populateChooseOpSubmenu(operations);
 
-    for (const auto& op : operations) {
-      auto newAction = new QAction(op.name, chooseOpSubmenu);
-
-      if (currentOp == op.slug) {
-        newAction->setCheckable(true);
-        newAction->setChecked(true);
-        selectedAction = newAction;
-      }
-
-      connect(newAction, &QAction::triggered, [this, newAction, op] {
-        AppSettings::getInstance().setLastUsedTags(std::vector<model::Tag>{}); // clear last used tags
-        AppSettings::getInstance().setOperationDetails(op.slug, op.name);
-        if (selectedAction != nullptr) {
-          selectedAction->setChecked(false);
-          selectedAction->setCheckable(false);
-        }
-        newAction->setCheckable(true);
-        newAction->setChecked(true);
-        selectedAction = newAction;
-      });
-      allOperationActions.push_back(newAction);
-      chooseOpSubmenu->addAction(newAction);
-    }
     if (selectedAction == nullptr) {
       AppSettings::getInstance().setOperationDetails("", "");
     }
   }
   else {
-    chooseOpStatusAction->setText(tr("Unable to load operations"));
+    chooseOpStatusAction->setText(allOperationActions.empty()
+                                      ? tr("Unable to load operations")
+                                      : tr("Unable to load operations: showing last known"));
+    connectivityMonitor->checkNow();
+  }
+}
+
+void TrayManager::onConnectivityChanged(bool online) {
+  uploadQueue->setPaused(!online);
+  if (online) {
+    chooseOpStatusAction->setText("Loading operations...");
+    NetMan::getInstance().refreshOperationsList();
+  }
+  else {
+    newOperationAction->setEnabled(false);
+    chooseOpStatusAction->setText(tr("Offline: showing last known operations"));
+  }
+}
+
+void TrayManager::populateChooseOpSubmenu(const std::vector<dto::Operation>& operations) {
+  auto currentOp = AppSettings::getInstance().operationSlug();
+  cleanChooseOpSubmenu();
+
+  for (const auto& op : operations) {
+    auto newAction = new QAction(op.name, chooseOpSubmenu);
+
+    if (currentOp == op.slug) {
+      newAction->setCheckable(true);
+      newAction->setChecked(true);
+      selectedAction = newAction;
+    }
+
+    connect(newAction, &QAction::triggered, [this, newAction, op] {
+      AppSettings::getInstance().setLastUsedTags(std::vector<model::Tag>{}); // clear last used tags
+      AppSettings::getInstance().setOperationDetails(op.slug, op.name);
+      if (selectedAction != nullptr) {
+        selectedAction->setChecked(false);
+        selectedAction->setCheckable(false);
+      }
+      newAction->setCheckable(true);
+      newAction->setChecked(true);
+      selectedAction = newAction;
+    });
+    allOperationActions.push_back(newAction);
+    chooseOpSubmenu->addAction(newAction);
   }
 }
 
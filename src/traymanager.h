@@ -8,12 +8,16 @@
 #include <QTimer>
 
 #include "db/databaseconnection.h"
+#include "db/databaseworker.h"
 #include "dtos/operation.h"
 #include "dtos/github_release.h"
 #include "forms/credits/credits.h"
 #include "forms/evidence/evidencemanager.h"
 #include "forms/settings/settings.h"
+#include "helpers/burstcapture.h"
+#include "helpers/connectivitymonitor.h"
 #include "helpers/screenshot.h"
+#include "helpers/uploadqueue.h"
 #include "hotkeymanager.h"
 #include "tools/UGlobalHotkey/uglobalhotkeys.h"
 #include "forms/add_operation/createoperation.h"
@@ -39,21 +43,29 @@ class TrayManager : public QDialog {
   Q_OBJECT
 
  public:
-  TrayManager(DatabaseConnection *);
+  TrayManager(DatabaseConnection *, DatabaseWorker *);
   ~TrayManager();
 
  private:
   void buildUi();
   void wireUi();
   qint64 createNewEvidence(QString filepath, QString evidenceType);
+  void computeContentHash(qint64 evidenceID, QString filepath);
+  void computePerceptualHash(qint64 evidenceID, QString filepath);
+  void backfillPerceptualHashes(qint64 afterID = 0,
+                                const std::vector<model::Evidence> &hashed = {});
+  void onBurstCaptured(std::vector<model::Evidence> frames, int droppedFrames);
   void spawnGetInfoWindow(qint64 evidenceID);
   void showNoOperationSetTrayMessage();
+  void prewarmConnection();
   void checkForUpdate();
   void cleanChooseOpSubmenu();
+  void populateChooseOpSubmenu(const std::vector<dto::Operation> &operations);
 
  private slots:
   void onOperationListUpdated(bool success, const std::vector<dto::Operation> &operations);
   void onReleaseCheck(bool success, std::vector<dto::GithubRelease> releases);
+  void onConnectivityChanged(bool online);
 
  public slots:
   void onScreenshotCaptured(const QString &filepath);
@@ -61,6 +73,7 @@ class TrayManager : public QDialog {
   void onCodeblockCapture();
   void captureAreaActionTriggered();
   void captureWindowActionTriggered();
+  void captureBurstActionTriggered();
   void captureCodeblockActionTriggered();
 
  protected:
@@ -68,8 +81,12 @@ class TrayManager : public QDialog {
 
  private:
   DatabaseConnection *db = nullptr;
+  DatabaseWorker *dbWorker = nullptr;
   HotkeyManager *hotkeyManager = nullptr;
   Screenshot *screenshotTool = nullptr;
+  BurstCapture *burstTool = nullptr;
+  UploadQueue *uploadQueue = nullptr;
+  ConnectivityMonitor *connectivityMonitor = nullptr;
   QTimer *updateCheckTimer = nullptr;
 
   // Subwindows
@@ -87,9 +104,11 @@ class TrayManager : public QDialog {
   QAction *currentOperationMenuAction = nullptr;
   QAction *captureScreenAreaAction = nullptr;
   QAction *captureWindowAction = nullptr;
+  QAction *captureBurstAction = nullptr;
   QAction *showEvidenceManagerAction = nullptr;
   QAction *showCreditsAction = nullptr;
   QAction *addCodeblockAction = nullptr;
+  QAction *workOfflineAction = nullptr;
 
   QMenu *chooseOpSubmenu = nullptr;
   QAction *chooseOpStatusAction = nullptr;
@@ -0,0 +1,28 @@
+# dbtest covers DatabaseConnection against a throwaway database. See Readme_Developer.md
+
+QT       += core gui sql testlib
+QT       -= widgets
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Constants (used by DatabaseConnection) expects the build details that ashirt.pro provides
+DEFINES += "VERSION_TAG=\\\"v0.0.0-development\\\"" \
+           "COMMIT_HASH=\\\"Unknown\\\"" \
+           "SOURCE_CONTROL_REPO=\\\"\\\""
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    tst_databaseconnection.cpp \
+    ../../src/db/databaseconnection.cpp \
+    ../../src/forms/evidence_filter/evidencefilter.cpp
+
+HEADERS += \
+    ../../src/db/databaseconnection.h \
+    ../../src/forms/evidence_filter/evidencefilter.h
+
+RESOURCES += \
+    ../../res_migrations.qrc
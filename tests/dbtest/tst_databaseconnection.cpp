@@ -0,0 +1,150 @@
+// Copyright 2020, Verizon Media
+// Licensed under the terms of MIT. See LICENSE file in project root for terms.
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QtTest>
+#include <algorithm>
+#include <vector>
+
+#include "db/databaseconnection.h"
+#include "helpers/constants.h"
+
+/**
+ * @brief TestDatabaseConnection exercises DatabaseConnection against a throwaway database, created
+ * under Qt's test-mode data location (so the real evidence database is never touched).
+ */
+class TestDatabaseConnection : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void cleanup();
+
+  void deleteEvidenceSpanningChunks();
+  void deleteEvidenceSkipsUnknownIDs();
+
+ private:
+  std::vector<qint64> createTaggedEvidence(int count);
+  int countRows(const QString &table);
+
+  DatabaseConnection *db = nullptr;
+  QSqlDatabase raw;
+};
+
+// removeDatabase deletes the given database file, along with its journal and WAL files
+static void removeDatabase(const QString &path) {
+  for (const QString &suffix : {"", "-journal", "-wal", "-shm"}) {
+    QFile::remove(path + suffix);
+  }
+}
+
+void TestDatabaseConnection::initTestCase() {
+  QStandardPaths::setTestModeEnabled(true);
+  qRegisterMetaType<std::vector<qint64>>();
+  removeDatabase(Constants::dbLocation());
+
+  db = new DatabaseConnection("dbtest");
+  db->connect();
+  raw = QSqlDatabase::addDatabase("QSQLITE", "dbtest-raw");
+  raw.setDatabaseName(Constants::dbLocation());
+  QVERIFY2(raw.open(), qPrintable(raw.lastError().text()));
+}
+
+void TestDatabaseConnection::cleanupTestCase() {
+  raw.close();
+  raw = QSqlDatabase();
+  QSqlDatabase::removeDatabase("dbtest-raw");
+  db->close();
+  delete db;
+  removeDatabase(Constants::dbLocation());
+}
+
+// cleanup empties the database after each test, so that row counts start from zero
+void TestDatabaseConnection::cleanup() {
+  QSqlQuery query(raw);
+  QVERIFY(query.exec("DELETE FROM tags"));
+  QVERIFY(query.exec("DELETE FROM evidence"));
+}
+
+// createTaggedEvidence creates count evidence, each with two tags, and returns their IDs. The tags
+// are inserted directly, in one transaction, to keep setup quick.
+std::vector<qint64> TestDatabaseConnection::createTaggedEvidence(int count) {
+  std::vector<qint64> ids;
+  for (int i = 0; i < count; i++) {
+    ids.push_back(db->createEvidence("/evidence/op/" + QString::number(i) + ".png", "op", "image"));
+  }
+  raw.transaction();
+  QSqlQuery query(raw);
+  query.prepare("INSERT INTO tags (evidence_id, tag_id, name) VALUES (?, ?, ?)");
+  for (qint64 id : ids) {
+    for (int tagID : {1, 2}) {
+      query.addBindValue(id);
+      query.addBindValue(tagID);
+      query.addBindValue("tag" + QString::number(tagID));
+      if (!query.exec()) {
+        qWarning() << query.lastError().text();
+      }
+    }
+  }
+  raw.commit();
+  return ids;
+}
+
+int TestDatabaseConnection::countRows(const QString &table) {
+  QSqlQuery query(raw);
+  if (!query.exec("SELECT COUNT(*) FROM " + table) || !query.next()) {
+    return -1;
+  }
+  return query.value(0).toInt();
+}
+
+// deleteEvidenceSpanningChunks deletes more evidence than fits in one statement's parameters, so
+// that the deletes are split into chunks, and checks that every chunk is applied
+void TestDatabaseConnection::deleteEvidenceSpanningChunks() {
+  auto ids = createTaggedEvidence(2500);
+  QCOMPARE(countRows("evidence"), 2500);
+  QCOMPARE(countRows("tags"), 5000);
+
+  QSignalSpy deleted(db, &DatabaseConnection::evidenceDeleted);
+  auto removed = db->deleteEvidence(ids);
+
+  QCOMPARE(removed.size(), ids.size());
+  QCOMPARE(removed.front().path, QString("/evidence/op/0.png"));
+  QVERIFY(db->getEvidenceDetails(ids).empty());
+  QCOMPARE(countRows("evidence"), 0);
+  QCOMPARE(countRows("tags"), 0);
+
+  QCOMPARE(deleted.count(), 1);
+  auto deletedIDs = deleted.takeFirst().at(0).value<std::vector<qint64>>();
+  std::sort(deletedIDs.begin(), deletedIDs.end());
+  QCOMPARE(deletedIDs, ids);
+}
+
+// deleteEvidenceSkipsUnknownIDs checks that IDs that do not exist are skipped (and not announced),
+// and that evidence not asked for is left alone
+void TestDatabaseConnection::deleteEvidenceSkipsUnknownIDs() {
+  auto ids = createTaggedEvidence(3);
+  qint64 unknownID = ids.back() + 1000;
+
+  QSignalSpy deleted(db, &DatabaseConnection::evidenceDeleted);
+  auto removed = db->deleteEvidence(std::vector<qint64>{ids[0], unknownID});
+
+  QCOMPARE(removed.size(), size_t(1));
+  QCOMPARE(removed.front().id, ids[0]);
+  QCOMPARE(countRows("evidence"), 2);
+  QCOMPARE(countRows("tags"), 4);
+  QCOMPARE(deleted.count(), 1);
+  QCOMPARE(deleted.takeFirst().at(0).value<std::vector<qint64>>(), std::vector<qint64>{ids[0]});
+
+  QVERIFY(db->deleteEvidence(std::vector<qint64>{unknownID}).empty());
+  QCOMPARE(deleted.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestDatabaseConnection)
+#include "tst_databaseconnection.moc"